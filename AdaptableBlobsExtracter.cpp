@@ -1,9 +1,12 @@
 #include "AdaptableBlobsExtracter.h"
 #include "opencv2/features2d/features2d.hpp"
-#include "opencv2/photo/photo.hpp"
 #include "mser2.hpp"
 #include "mser3.hpp"
 #include "BlobResult.h"
+#include "DepthPyramid.h"
+
+// the canvas is labelled only in the tiles under the squares drawn this frame
+static const int canvasTileSize = 16;
 
 AdaptableBlobsExtracter::AdaptableBlobsExtracter(int minArea, int maxArea, int margin)
 {
@@ -11,40 +14,158 @@ AdaptableBlobsExtracter::AdaptableBlobsExtracter(int minArea, int maxArea, int m
     _maxArea = maxArea;
     _margin = margin;
 
+    _fullScanInterval = 0;
+    _entryBand = 40;
+    _padding = 10;
+    _frameNo = 0;
+
+    _pyramid = 1;
+    _pyramidPadding = 8;
+
+    _scanDepthMin = 0;
+    _scanDepthBucket = 0;
+
     _mser3 = cv::MSER3::create(2, minArea, maxArea);
 }
 
-void AdaptableBlobsExtracter::extracts(const cv::Mat& src, cv::Mat& dst) {
+void AdaptableBlobsExtracter::setPyramid(int factor, int padding) {
+    _pyramid = factor;
+    _pyramidPadding = padding;
+    _coarseMser.release();
+    if (factor > 1) {
+        int area = factor*factor;
+        _coarseMser = cv::MSER3::create(2, std::max(1, _minArea / area), std::max(2, _maxArea / area));
+    }
+}
+
+void AdaptableBlobsExtracter::setIncremental(int fullScanInterval, int entryBand, int padding) {
+    _fullScanInterval = fullScanInterval;
+    _entryBand = entryBand;
+    _padding = padding;
+    _frameNo = 0;
+}
+
+void AdaptableBlobsExtracter::setSearchRegions(const std::vector<cv::Rect>& regions) {
+    _searchRegions = regions;
+}
+
+void AdaptableBlobsExtracter::searchWindows(const cv::Size& size, std::vector<cv::Rect>& windows) const {
+    cv::Rect frame(0, 0, size.width, size.height);
+    int band = std::min(_entryBand, std::min(size.width, size.height) / 2);
 
-    cv::normalize(src, src, 0, 255, cv::NORM_MINMAX);
-    cv::Mat normalized = cv::Mat::zeros(src.rows, src.cols, CV_8UC1);
-    cv::convertScaleAbs(src, normalized);
+    // padded search regions, overlapping ones merged so no pixel is scanned twice
+    std::vector<cv::Rect> regions;
+    for (size_t i = 0; i < _searchRegions.size(); ++i) {
+        cv::Rect rc = _searchRegions[i];
+        rc.x -= _padding;
+        rc.y -= _padding;
+        rc.width += 2*_padding;
+        rc.height += 2*_padding;
+        rc &= frame;
+        if (rc.area() > 0) {
+            regions.push_back(rc);
+        }
+    }
+
+    mergeRects(regions);
+
+    windows = regions;
+
+    // entry bands, the side ones stop short of the top and bottom bands
+    if (band > 0) {
+        windows.push_back(cv::Rect(0, 0, size.width, band));
+        windows.push_back(cv::Rect(0, size.height - band, size.width, band));
+        windows.push_back(cv::Rect(0, band, band, size.height - 2*band));
+        windows.push_back(cv::Rect(size.width - band, band, band, size.height - 2*band));
+    }
 
-    cv::Mat mask = cv::Mat::zeros(src.rows, src.cols, CV_8UC1);
-    cv::threshold(normalized, mask, 0, 255, cv::THRESH_BINARY_INV);
+    dropTinyWindows(windows);
+}
 
-    cv::Mat paint = cv::Mat::zeros(src.rows, src.cols, CV_8UC1);
-    cv::inpaint(normalized, mask, paint, 3, cv::INPAINT_TELEA);
+void AdaptableBlobsExtracter::dropTinyWindows(std::vector<cv::Rect>& windows) {
+    // MSER3 needs at least 3x3 pixels
+    for (size_t i = windows.size(); i-- > 0; ) {
+        if (windows[i].width < 3 || windows[i].height < 3) {
+            windows.erase(windows.begin() + i);
+        }
+    }
+}
+
+void AdaptableBlobsExtracter::detectInWindows(const cv::Mat& src, const std::vector<cv::Rect>& windows, std::vector<cv::Rect>& bboxes) {
+    // regions are not collected for windows
+    std::vector<std::vector<cv::Point>> regions;
+    std::vector<cv::Rect> winBboxes;
+    for (size_t i = 0; i < windows.size(); ++i) {
+        _mser3->detectRegions(src(windows[i]), regions, winBboxes);
+        for (size_t j = 0; j < winBboxes.size(); ++j) {
+            bboxes.push_back(winBboxes[j] + windows[i].tl());
+        }
+    }
+}
+
+void AdaptableBlobsExtracter::extractBlobs(const cv::Mat& src, CBlobResult& blobResult) {
 
     std::vector<std::vector<cv::Point>> regions;
     std::vector<cv::Rect> bboxes;
 
+    // MSER3 works on the raw 16-bit depth, zero (unknown) pixels need no inpainting
     //mser2->detectRegions(paint, regions, bboxes, 1);
-    _mser3->detectRegions(paint, regions, bboxes);
-    //dst = cv::Mat::zeros(src.rows, src.cols, CV_8UC1);
-    dst.setTo(0);
-//    cv::imshow("normalized", normalized);
-//    cv::waitKey(10);
-
-    //for (int i = 0; i < regions.size(); ++i) {
-    //    std::vector<cv::Point>& contour = regions[i];
-    //    cv::RotatedRect rrc = cv::minAreaRect(contour);
-    //
-    //    if (rrc.size.area() > 500 && rrc.size.area() < 2000) {
-    //        cv::polylines(dst, contour, true, cv::Scalar(255), 1);
-    //    }
-    //}
+    bool incremental = _fullScanInterval > 1 && _frameNo % _fullScanInterval != 0 && _scanDepthBucket > 0;
 
+    // Left alone, MSER3 would quantize each window by its own depth range: much
+    // finer levels around one head than in a full scan, so delta would test a
+    // different depth step. Windows reuse the quantization of the last full scan.
+    int depthMin = _mser3->getDepthMin();
+    int depthBucket = _mser3->getDepthBucket();
+    if (incremental) {
+        // only the windows where blobs can be
+        _mser3->setDepthMin(_scanDepthMin);
+        _mser3->setDepthBucket(_scanDepthBucket);
+        std::vector<cv::Rect> windows;
+        searchWindows(src.size(), windows);
+        detectInWindows(src, windows, bboxes);
+    } else if (!_coarseMser.empty()) {
+        // candidates on the min-pooled image, refined at full resolution in their windows
+        minPoolDepth(src, _pooled, _pyramid);
+
+        std::vector<cv::Rect> coarse;
+        _coarseMser->setDepthMin(depthMin);
+        _coarseMser->setDepthBucket(depthBucket);
+        _coarseMser->detectRegions(_pooled, regions, coarse);
+        regions.clear();
+
+        // min pooling keeps the frame's nearest depth, the pooled quantization
+        // stands in for the full frame's without scanning it
+        _coarseMser->getLastQuantization(_scanDepthMin, _scanDepthBucket);
+        _mser3->setDepthMin(_scanDepthMin);
+        _mser3->setDepthBucket(_scanDepthBucket);
+
+        std::vector<cv::Rect> windows;
+        coarseToFineWindows(coarse, _pyramid, _pyramidPadding, src.size(), windows);
+        dropTinyWindows(windows);
+        detectInWindows(src, windows, bboxes);
+    } else {
+        _mser3->detectRegions(src, regions, bboxes);
+        _mser3->getLastQuantization(_scanDepthMin, _scanDepthBucket);
+    }
+    _mser3->setDepthMin(depthMin);
+    _mser3->setDepthBucket(depthBucket);
+    ++_frameNo;
+
+    // Squares around the accepted boxes are labelled into blobs. Only last
+    // frame's squares are cleared and only the tiles under this frame's are
+    // labelled, so the cost follows the number of people, not the frame size.
+    if (_canvas.size() != src.size()) {
+        _canvas.create(src.size(), CV_8UC1);
+        _canvas.setTo(0);
+        _squares.clear();
+    }
+    for (size_t i = 0; i < _squares.size(); ++i) {
+        _canvas(_squares[i]).setTo(0);
+    }
+    _squares.clear();
+
+    cv::Rect frame(0, 0, src.cols, src.rows);
     for (size_t i = 0; i < bboxes.size(); ++i) {
         double a = std::max(bboxes[i].width, bboxes[i].height);
         double b = std::min(bboxes[i].width, bboxes[i].height);
@@ -57,21 +178,33 @@ void AdaptableBlobsExtracter::extracts(const cv::Mat& src, cv::Mat& dst) {
         rc.y = pt.y - 10;
         rc.width = 20;
         rc.height = 20;
+        rc &= frame;
         if (bboxes[i].area() > _minArea*1.261829 &&
                 bboxes[i].area() < _maxArea*1.261829 &&
-                alpha < 0.3) {
-            cv::rectangle(dst, rc, cv::Scalar(255), -1);
+                alpha < 0.3 && rc.area() > 0) {
+            _canvas(rc).setTo(255);
+            _squares.push_back(rc);
         }
     }
 
-    CBlobResult blobResult = CBlobResult(dst, cv::Mat(), 2);
+    _tiles.create((src.rows + canvasTileSize - 1) / canvasTileSize,
+                  (src.cols + canvasTileSize - 1) / canvasTileSize, CV_8UC1);
+    _tiles.setTo(0);
+    for (size_t i = 0; i < _squares.size(); ++i) {
+        const cv::Rect& rc = _squares[i];
+        int x0 = rc.x / canvasTileSize, x1 = (rc.x + rc.width - 1) / canvasTileSize;
+        int y0 = rc.y / canvasTileSize, y1 = (rc.y + rc.height - 1) / canvasTileSize;
+        _tiles(cv::Rect(x0, y0, x1 - x0 + 1, y1 - y0 + 1)).setTo(255);
+    }
+
+    blobResult = CBlobResult(_canvas, cv::Mat(), 2, _tiles, canvasTileSize);
 
     // 过滤掉与图像上、下、左、右四个边缘相交的团块
     blobResult.Filter(blobResult,
                       FLT_EXCLUDE,
                       CBlobGetMaxY(),
                       FLT_GREATEROREQUAL,
-                      mask.rows-_margin);
+                      src.rows-_margin);
 
     blobResult.Filter(blobResult,
                       FLT_EXCLUDE,
@@ -89,7 +222,12 @@ void AdaptableBlobsExtracter::extracts(const cv::Mat& src, cv::Mat& dst) {
                       FLT_EXCLUDE,
                       CBlobGetMaxX(),
                       FLT_GREATEROREQUAL,
-                      mask.cols-_margin);
+                      src.cols-_margin);
+}
+
+void AdaptableBlobsExtracter::extracts(const cv::Mat& src, cv::Mat& dst) {
+    CBlobResult blobResult;
+    extractBlobs(src, blobResult);
 
     int histNum = blobResult.GetNumBlobs();
 
@@ -104,3 +242,15 @@ void AdaptableBlobsExtracter::extracts(const cv::Mat& src, cv::Mat& dst) {
     }
 }
 
+bool AdaptableBlobsExtracter::detects(const cv::Mat& src, std::vector<Detection>& detections, bool withRuns) {
+    CBlobResult blobResult;
+    extractBlobs(src, blobResult);
+
+    int num = blobResult.GetNumBlobs();
+    detections.resize(num);
+    for (int i = 0; i < num; ++i) {
+        blobToDetection(blobResult.GetBlob(i), cv::Point(0, 0), withRuns, detections[i]);
+    }
+
+    return true;
+}
@@ -4,6 +4,8 @@
 #include "IExtracter.h"
 #include "opencv2/core/core.hpp"
 #include "mser3.hpp"
+#include "BlobResult.h"
+#include <vector>
 
 class AdaptableBlobsExtracter : public IExtracter
 {
@@ -12,12 +14,56 @@ public:
 
     void extracts(const cv::Mat& src, cv::Mat& dst);
 
+    bool detects(const cv::Mat& src, std::vector<Detection>& detections, bool withRuns = false);
+
+    // Incremental detection: between full-frame scans (one every fullScanInterval
+    // frames) MSER3 only runs inside the search regions, grown by padding, and
+    // inside entryBand wide bands along the frame borders.
+    // fullScanInterval <= 1 scans every frame in full.
+    void setIncremental(int fullScanInterval, int entryBand = 40, int padding = 10);
+
+    // Regions where known blobs are expected in the next frame, usually
+    // BlobTracker::predictedRegions().
+    void setSearchRegions(const std::vector<cv::Rect>& regions);
+
+    // Coarse-to-fine mode for the full scans: MSER3 first runs on a 1/factor
+    // min-pooled depth image and only the candidate windows, grown by padding,
+    // are scanned at full resolution. factor <= 1 turns it off.
+    void setPyramid(int factor = 4, int padding = 8);
+
 private:
+    // Candidate squares are drawn into _canvas and labelled into blobResult.
+    void extractBlobs(const cv::Mat& src, CBlobResult& blobResult);
+
+    void searchWindows(const cv::Size& size, std::vector<cv::Rect>& windows) const;
+
+    static void dropTinyWindows(std::vector<cv::Rect>& windows);
+
+    void detectInWindows(const cv::Mat& src, const std::vector<cv::Rect>& windows, std::vector<cv::Rect>& bboxes);
+
     cv::Ptr<cv::MSER3> _mser3;
 
     int _margin;
     int _minArea;
     int _maxArea;
+
+    int _fullScanInterval;
+    int _entryBand;
+    int _padding;
+    unsigned int _frameNo;
+    std::vector<cv::Rect> _searchRegions;
+    // quantization of the last full scan, reused by the incremental frames
+    int _scanDepthMin;
+    int _scanDepthBucket;
+
+    cv::Mat _canvas;
+    std::vector<cv::Rect> _squares;
+    cv::Mat _tiles;
+
+    int _pyramid;
+    int _pyramidPadding;
+    cv::Ptr<cv::MSER3> _coarseMser;
+    cv::Mat _pooled;
 };
 
 #endif // AdaptableBlobsExtracter_H
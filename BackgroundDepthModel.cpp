@@ -0,0 +1,132 @@
+#include "BackgroundDepthModel.h"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <algorithm>
+#include <climits>
+
+BackgroundDepthModel::BackgroundDepthModel(int tileSize,
+                                           int threshold,
+                                           float learningRate,
+                                           int minTilePixels,
+                                           int absorbFrames)
+{
+    _tileSize = std::max(tileSize, 1);
+    _threshold = threshold;
+    _learningRate = learningRate;
+    _minTilePixels = minTilePixels;
+    _absorbFrames = std::max(std::min(absorbFrames, (int)USHRT_MAX), 1);
+    _activeCount = 0;
+}
+
+void BackgroundDepthModel::reset() {
+    _background.release();
+    _activeCount = 0;
+}
+
+void BackgroundDepthModel::apply(const cv::Mat& src) {
+
+    assert(src.type() == CV_16UC1);
+
+    int tileRows = (src.rows + _tileSize - 1) / _tileSize;
+    int tileCols = (src.cols + _tileSize - 1) / _tileSize;
+
+    if (_background.size() != src.size()) {
+        _background = cv::Mat::zeros(src.size(), CV_32FC1);
+        _age = cv::Mat::zeros(src.size(), CV_16UC1);
+    }
+    // 成员缓冲区复用，空闲帧上不再分配内存
+    _counts.create(tileRows, tileCols, CV_32SC1);
+    _counts.setTo(0);
+
+    float threshold = (float)_threshold;
+    for (int i = 0; i < src.rows; ++i) {
+        const ushort* sptr = src.ptr<ushort>(i);
+        float* bptr = _background.ptr<float>(i);
+        ushort* aptr = _age.ptr<ushort>(i);
+        int* cptr = _counts.ptr<int>(i / _tileSize);
+        for (int j = 0; j < src.cols; ++j) {
+            float d = sptr[j];
+            if (d == 0) {
+                continue;
+            }
+
+            float b = bptr[j];
+            if (b == 0 || d > b + threshold) {
+                // 还没有背景，或者背景变远了（物体移走）
+                bptr[j] = d;
+                aptr[j] = 0;
+            } else if (d < b - threshold) {
+                // 比背景近的是前景，不参与背景更新；停留太久的前景直接并入背景
+                if (++aptr[j] >= _absorbFrames) {
+                    bptr[j] = d;
+                    aptr[j] = 0;
+                } else {
+                    ++cptr[j / _tileSize];
+                }
+            } else {
+                bptr[j] = b + _learningRate * (d - b);
+                aptr[j] = 0;
+            }
+        }
+    }
+
+    cv::compare(_counts, _minTilePixels, _tiles, cv::CMP_GE);
+    _activeCount = cv::countNonZero(_tiles);
+
+    // 向外扩一块，跨块的团块不会被截断
+    if (_activeCount > 0) {
+        cv::dilate(_tiles, _grown, cv::Mat());
+    } else {
+        _grown.create(_tiles.size(), CV_8UC1);
+        _grown.setTo(0);
+    }
+}
+
+cv::Rect BackgroundDepthModel::activeRect() const {
+    if (_activeCount == 0) {
+        return cv::Rect();
+    }
+
+    int minX = INT_MAX, minY = INT_MAX, maxX = -1, maxY = -1;
+    for (int i = 0; i < _grown.rows; ++i) {
+        const uchar* gptr = _grown.ptr<uchar>(i);
+        for (int j = 0; j < _grown.cols; ++j) {
+            if (gptr[j]) {
+                minX = std::min(minX, j);
+                maxX = std::max(maxX, j);
+                minY = std::min(minY, i);
+                maxY = std::max(maxY, i);
+            }
+        }
+    }
+
+    cv::Rect rc(minX * _tileSize, minY * _tileSize,
+                (maxX - minX + 1) * _tileSize, (maxY - minY + 1) * _tileSize);
+    return rc & cv::Rect(0, 0, _background.cols, _background.rows);
+}
+
+cv::Rect BackgroundDepthModel::alignedRect(const cv::Rect& rect) const {
+    int x0 = rect.x / _tileSize * _tileSize;
+    int y0 = rect.y / _tileSize * _tileSize;
+    int x1 = (rect.x + rect.width + _tileSize - 1) / _tileSize * _tileSize;
+    int y1 = (rect.y + rect.height + _tileSize - 1) / _tileSize * _tileSize;
+    return cv::Rect(x0, y0, x1 - x0, y1 - y0) & cv::Rect(0, 0, _background.cols, _background.rows);
+}
+
+cv::Mat BackgroundDepthModel::grownTiles(const cv::Rect& rect) const {
+    cv::Rect tiles(rect.x / _tileSize, rect.y / _tileSize,
+                   (rect.width + _tileSize - 1) / _tileSize,
+                   (rect.height + _tileSize - 1) / _tileSize);
+    return _grown(tiles & cv::Rect(0, 0, _grown.cols, _grown.rows));
+}
+
+void BackgroundDepthModel::maskInactive(cv::Mat& dst, const cv::Point& offset) const {
+    for (int i = 0; i < dst.rows; ++i) {
+        const uchar* gptr = _grown.ptr<uchar>((i + offset.y) / _tileSize);
+        ushort* dptr = dst.ptr<ushort>(i);
+        for (int j = 0; j < dst.cols; ++j) {
+            if (!gptr[(j + offset.x) / _tileSize]) {
+                dptr[j] = 0;
+            }
+        }
+    }
+}
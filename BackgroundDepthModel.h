@@ -0,0 +1,64 @@
+#ifndef BACKGROUNDDEPTHMODEL_H
+#define BACKGROUNDDEPTHMODEL_H
+
+#include "opencv2/core/core.hpp"
+
+// Per-pixel running background depth. A pixel is foreground when it is more
+// than threshold closer to the camera than the background; the foreground is
+// summarized on a coarse tile grid so the extracters only look at the tiles
+// that changed, and skip frames with no active tile at all. Foreground that
+// stays put for absorbFrames updates (e.g. a bag left in the doorway) is taken
+// into the background, so its tiles do not stay active for good.
+class BackgroundDepthModel
+{
+public:
+    BackgroundDepthModel(int tileSize = 16,
+                         int threshold = 100,
+                         float learningRate = 0.02,
+                         int minTilePixels = 8,
+                         int absorbFrames = 300);
+
+    // Classifies src against the model, then updates the model.
+    void apply(const cv::Mat& src);
+
+    void reset();
+
+    bool hasForeground() const { return _activeCount > 0; }
+
+    // One byte per tile, non-zero for tiles holding foreground pixels.
+    const cv::Mat& activeTiles() const { return _tiles; }
+
+    int tileSize() const { return _tileSize; }
+
+    // Bounding box in pixels of the active tiles grown by one tile,
+    // empty when there is no foreground.
+    cv::Rect activeRect() const;
+
+    // Smallest tile aligned rect holding rect, clipped to the frame, so it
+    // can be intersected with activeRect() and passed to grownTiles().
+    cv::Rect alignedRect(const cv::Rect& rect) const;
+
+    // Active tiles grown by one tile, for the part of the frame covered by
+    // rect (tile aligned, e.g. activeRect()).
+    cv::Mat grownTiles(const cv::Rect& rect) const;
+
+    // Zeroes the pixels of dst, a CV_16UC1 part of the frame starting at offset,
+    // that lie outside the active tiles grown by one tile.
+    void maskInactive(cv::Mat& dst, const cv::Point& offset = cv::Point()) const;
+
+private:
+    int _tileSize;
+    int _threshold;
+    float _learningRate;
+    int _minTilePixels;
+    int _absorbFrames;
+
+    cv::Mat _background;
+    cv::Mat _age;
+    cv::Mat _counts;
+    cv::Mat _tiles;
+    cv::Mat _grown;
+    int _activeCount;
+};
+
+#endif // BACKGROUNDDEPTHMODEL_H
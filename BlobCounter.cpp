@@ -14,6 +14,11 @@
 
 //#include "stdafx.h"
 #include "BlobCounter.h"
+#include "CrossingEventStream.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "opencv2/imgproc.hpp"
 
 template<typename T> bool isPointInRect(T x, T y, T rect_x1, T rect_y1, T rect_x2, T rect_y2) {
     if(((x < rect_x1 && x > rect_x2) || (x >rect_x1 && x < rect_x2)) &&
@@ -22,11 +27,34 @@ template<typename T> bool isPointInRect(T x, T y, T rect_x1, T rect_y1, T rect_x
     return false;
 }
 
+//点 p 相对有向线段 a->b 的位置：>0 左侧，<0 右侧
+static double crossProduct(const CvPoint2D64f& a, const CvPoint2D64f& b, const CvPoint2D64f& p) {
+    return (b.x - a.x)*(p.y - a.y) - (b.y - a.y)*(p.x - a.x);
+}
+
+static double distanceToSegment(const CvPoint2D64f& p, const CvPoint2D64f& a, const CvPoint2D64f& b) {
+    double dx = b.x - a.x, dy = b.y - a.y;
+    double len2 = dx*dx + dy*dy;
+    double t = len2 > 0 ? ((p.x - a.x)*dx + (p.y - a.y)*dy)/len2 : 0;
+    t = std::max(0.0, std::min(1.0, t));
+    double ex = a.x + t*dx - p.x, ey = a.y + t*dy - p.y;
+    return sqrt(ex*ex + ey*ey);
+}
+
 BlobCounter::BlobCounter() {
-    _blobMap.clear();
+    _blobCount = 0;
     _rectInfoVec.clear();
     _iPeople = 0;
     _oPeople = 0;
+    _stamp = 0;
+    _gridCols = 0;
+    _gridRows = 0;
+    _zoneHysteresis = 5.0;
+    _events = NULL;
+    _lineStatus = LINE_HORIZONTAL;
+    _distanceThreshold = 0.0;
+    _countingLinePos = 0.0;
+    _distancePixels = 0.0;
 }
 
 BlobCounter::~BlobCounter() {
@@ -59,6 +87,256 @@ void BlobCounter::init(const cv::Size& sceneSize,
     _distanceThreshold = distanceThreshold;
 
     _ioDirection = ioDirection;
+
+    updateGeometry();
+    compileZones();
+}
+
+void BlobCounter::updateGeometry() {
+    _countingLtPt = cv::Point2d(_sceneSize.width*_countingRectScale.ltScale.x, _sceneSize.height*_countingRectScale.ltScale.y);
+    _countingRbPt = cv::Point2d(_sceneSize.width*_countingRectScale.rbScale.x, _sceneSize.height*_countingRectScale.rbScale.y);
+
+    if (_lineStatus == LINE_VERTICAL) {
+        _countingLinePos = _countingLineScale.pt1Scale.x*_sceneSize.width;
+        _distancePixels = _distanceThreshold*_sceneSize.width;
+    } else {
+        _countingLinePos = _countingLineScale.pt1Scale.y*_sceneSize.height;
+        _distancePixels = _distanceThreshold*_sceneSize.height;
+    }
+}
+
+//线性探测：跟踪 ID 基本连续，直接取低位作为散列
+BlobInfo* BlobCounter::findBlob(int id) {
+    if (_blobSlots.empty()) {
+        return NULL;
+    }
+
+    size_t mask = _blobSlots.size() - 1;
+    for (size_t i = (size_t)id & mask; _blobSlots[i].used; i = (i + 1) & mask) {
+        if (_blobSlots[i].id == id) {
+            return &_blobSlots[i].info;
+        }
+    }
+
+    return NULL;
+}
+
+BlobInfo& BlobCounter::insertBlob(int id) {
+    BlobInfo* found = findBlob(id);
+    if (found) {
+        return *found;
+    }
+
+    //装载率保持在一半以下
+    if ((_blobCount + 1)*2 > _blobSlots.size()) {
+        std::vector<BlobSlot> old;
+        old.swap(_blobSlots);
+
+        BlobSlot empty;
+        empty.id = 0;
+        empty.used = false;
+        _blobSlots.assign(std::max<size_t>(old.size()*2, 64), empty);
+        _blobCount = 0;
+
+        for (size_t i = 0; i < old.size(); ++i) {
+            if (old[i].used) {
+                insertBlob(old[i].id) = old[i].info;
+            }
+        }
+    }
+
+    size_t mask = _blobSlots.size() - 1;
+    size_t i = (size_t)id & mask;
+    while (_blobSlots[i].used) {
+        i = (i + 1) & mask;
+    }
+
+    _blobSlots[i].id = id;
+    _blobSlots[i].used = true;
+    memset(&_blobSlots[i].info, 0, sizeof(BlobInfo));
+    ++_blobCount;
+
+    return _blobSlots[i].info;
+}
+
+void BlobCounter::eraseBlob(int id) {
+    if (_blobSlots.empty()) {
+        return;
+    }
+
+    size_t mask = _blobSlots.size() - 1;
+    size_t i = (size_t)id & mask;
+    while (_blobSlots[i].used && _blobSlots[i].id != id) {
+        i = (i + 1) & mask;
+    }
+
+    if (!_blobSlots[i].used) {
+        return;
+    }
+
+    _blobSlots[i].used = false;
+    --_blobCount;
+
+    //后移删除：把探测链上后面的元素挪回空位，不留墓碑
+    for (size_t j = (i + 1) & mask; _blobSlots[j].used; j = (j + 1) & mask) {
+        size_t home = (size_t)_blobSlots[j].id & mask;
+        bool between = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+        if (!between) {
+            _blobSlots[i] = _blobSlots[j];
+            _blobSlots[j].used = false;
+            i = j;
+        }
+    }
+}
+
+void BlobCounter::clearBlobs() {
+    for (size_t i = 0; i < _blobSlots.size(); ++i) {
+        _blobSlots[i].used = false;
+    }
+    _blobCount = 0;
+}
+
+int BlobCounter::addCountingZone(const CountingZone& zone) {
+    CountingZone z = zone;
+    z.nID = (int)_countingZones.size();
+    z.iPeople = 0;
+    z.oPeople = 0;
+
+    //多边形统一为内部在边的左侧
+    if (z.type == ZONE_POLYGON && z.ptScales.size() >= 3) {
+        double area = 0;
+        for (size_t i = 0; i < z.ptScales.size(); ++i) {
+            const CvPoint2D64f& a = z.ptScales[i];
+            const CvPoint2D64f& b = z.ptScales[(i + 1) % z.ptScales.size()];
+            area += a.x*b.y - b.x*a.y;
+        }
+        if (area < 0) {
+            std::reverse(z.ptScales.begin(), z.ptScales.end());
+        }
+    }
+
+    _countingZones.push_back(z);
+    compileZones();
+
+    return z.nID;
+}
+
+void BlobCounter::clearCountingZones() {
+    _countingZones.clear();
+    compileZones();
+}
+
+void BlobCounter::setZoneHysteresis(double distance) {
+    _zoneHysteresis = distance;
+    compileZones();
+}
+
+void BlobCounter::compileZones() {
+    _zoneEdges.clear();
+    _zoneGrid.clear();
+    _gridCols = 0;
+    _gridRows = 0;
+
+    if (_countingZones.empty() || _sceneSize.area() <= 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < _countingZones.size(); ++i) {
+        const CountingZone& zone = _countingZones[i];
+        size_t n = zone.ptScales.size();
+        size_t nEdges = zone.type == ZONE_POLYGON && n >= 3 ? n : (n > 0 ? n - 1 : 0);
+        for (size_t j = 0; j < nEdges; ++j) {
+            const CvPoint2D64f& s1 = zone.ptScales[j];
+            const CvPoint2D64f& s2 = zone.ptScales[(j + 1) % n];
+            ZoneEdge edge;
+            edge.zone = (int)i;
+            edge.pt1 = cvPoint2D64f(s1.x*_sceneSize.width, s1.y*_sceneSize.height);
+            edge.pt2 = cvPoint2D64f(s2.x*_sceneSize.width, s2.y*_sceneSize.height);
+            _zoneEdges.push_back(edge);
+        }
+    }
+
+    _gridCols = (_sceneSize.width + ZONE_CELL_SIZE - 1)/ZONE_CELL_SIZE;
+    _gridRows = (_sceneSize.height + ZONE_CELL_SIZE - 1)/ZONE_CELL_SIZE;
+    _zoneGrid.resize(_gridCols*_gridRows);
+    _edgeStamp.assign(_zoneEdges.size(), 0);
+    _stamp = 0;
+
+    //每条边登记到它（连同滞回带）的外接矩形覆盖的网格
+    for (size_t e = 0; e < _zoneEdges.size(); ++e) {
+        const ZoneEdge& edge = _zoneEdges[e];
+        int x0 = (int)floor((std::min(edge.pt1.x, edge.pt2.x) - _zoneHysteresis)/ZONE_CELL_SIZE);
+        int x1 = (int)floor((std::max(edge.pt1.x, edge.pt2.x) + _zoneHysteresis)/ZONE_CELL_SIZE);
+        int y0 = (int)floor((std::min(edge.pt1.y, edge.pt2.y) - _zoneHysteresis)/ZONE_CELL_SIZE);
+        int y1 = (int)floor((std::max(edge.pt1.y, edge.pt2.y) + _zoneHysteresis)/ZONE_CELL_SIZE);
+        x0 = std::max(x0, 0); x1 = std::min(x1, _gridCols - 1);
+        y0 = std::max(y0, 0); y1 = std::min(y1, _gridRows - 1);
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                _zoneGrid[y*_gridCols + x].push_back((int)e);
+            }
+        }
+    }
+}
+
+void BlobCounter::countZones(int trackId, BlobInfo& obj, const CvPoint2D64f& centroid) {
+    if (_zoneEdges.empty()) {
+        return;
+    }
+
+    int cx = std::max(0, std::min(_gridCols - 1, (int)floor(centroid.x/ZONE_CELL_SIZE)));
+    int cy = std::max(0, std::min(_gridRows - 1, (int)floor(centroid.y/ZONE_CELL_SIZE)));
+
+    //当前质心还在某条边的滞回带内，等离开后再判断
+    const std::vector<int>& nearEdges = _zoneGrid[cy*_gridCols + cx];
+    for (size_t i = 0; i < nearEdges.size(); ++i) {
+        const ZoneEdge& edge = _zoneEdges[nearEdges[i]];
+        if (distanceToSegment(centroid, edge.pt1, edge.pt2) < _zoneHysteresis) {
+            return;
+        }
+    }
+
+    const CvPoint2D64f& p = obj.zoneCentroid;
+    int x0 = std::max(0, (int)floor(std::min(p.x, centroid.x)/ZONE_CELL_SIZE));
+    int x1 = std::min(_gridCols - 1, (int)floor(std::max(p.x, centroid.x)/ZONE_CELL_SIZE));
+    int y0 = std::max(0, (int)floor(std::min(p.y, centroid.y)/ZONE_CELL_SIZE));
+    int y1 = std::min(_gridRows - 1, (int)floor(std::max(p.y, centroid.y)/ZONE_CELL_SIZE));
+
+    ++_stamp;
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            const std::vector<int>& edges = _zoneGrid[y*_gridCols + x];
+            for (size_t i = 0; i < edges.size(); ++i) {
+                int e = edges[i];
+                if (_edgeStamp[e] == _stamp) {
+                    continue;
+                }
+                _edgeStamp[e] = _stamp;
+
+                //线段 p->centroid 与边相交
+                const ZoneEdge& edge = _zoneEdges[e];
+                double d1 = crossProduct(edge.pt1, edge.pt2, p);
+                double d2 = crossProduct(edge.pt1, edge.pt2, centroid);
+                double d3 = crossProduct(p, centroid, edge.pt1);
+                double d4 = crossProduct(p, centroid, edge.pt2);
+                if (d1*d2 >= 0 || d3*d4 >= 0) {
+                    continue;
+                }
+
+                CountingZone& zone = _countingZones[edge.zone];
+                bool toLeft = d2 > 0;
+                if (toLeft == (zone.inSide != ZONE_IN_RIGHT)) {
+                    ++zone.iPeople;
+                    emitCrossing(trackId, zone.nID, CROSSING_IN, centroid);
+                } else {
+                    ++zone.oPeople;
+                    emitCrossing(trackId, zone.nID, CROSSING_OUT, centroid);
+                }
+            }
+        }
+    }
+
+    obj.zoneCentroid = centroid;
 }
 
 void BlobCounter::blobAppear(cvb::CvTrack* blob) {
@@ -66,7 +344,7 @@ void BlobCounter::blobAppear(cvb::CvTrack* blob) {
         return;
     }
 
-    BlobInfo obj;
+    BlobInfo& obj = insertBlob(blob->id);
 
     obj.minx = blob->minx;
     obj.maxx = blob->maxx;
@@ -76,8 +354,9 @@ void BlobCounter::blobAppear(cvb::CvTrack* blob) {
     obj.centroid = blob->centroid;
 
     obj.sideOfLine = checkPointSide(obj.centroid);
+    obj.isInRect = 0;
 
-    _blobMap[blob->id] = obj;
+    obj.zoneCentroid = obj.centroid;
 }
 
 void BlobCounter::blobTraced(cvb::CvTrack* blob) {
@@ -94,21 +373,21 @@ void BlobCounter::blobDisappear(cvb::CvTrack* blob) {
         return;
     }
 
-    _blobMap.erase(_blobMap.find(blob->id));
+    eraseBlob(blob->id);
 }
 
 int BlobCounter::checkPointSide(CvPoint2D64f pt) {
     bool bResult = false;
 
     if (_lineStatus == LINE_HORIZONTAL) {
-        bResult = pt.y > (_countingLineScale.pt1Scale.y*_sceneSize.height) ? true : false;
+        bResult = pt.y > _countingLinePos ? true : false;
         if (bResult) {
             return SIDE_BOTTOM;
         } else {
             return SIDE_TOP;
         }
     } else if (_lineStatus == LINE_VERTICAL) {
-        bResult = pt.x > (_countingLineScale.pt1Scale.x*_sceneSize.width) ? true : false;
+        bResult = pt.x > _countingLinePos ? true : false;
 
         if (bResult) {
             return SIDE_RIGHT;
@@ -143,12 +422,20 @@ void BlobCounter::countTracedBlob(cvb::CvTrack* tracedBlob) {
     //新跟踪到是物件位置
    int tracedBlobSide = checkPointSide(tracedBlob->centroid);
 
-    //同一物件当前的位置
-    BlobInfo& obj = _blobMap[tracedBlob->id];
+    //同一物件当前的位置，没有记录的物件当作新出现
+    BlobInfo* found = findBlob(tracedBlob->id);
+    if (!found) {
+        blobAppear(tracedBlob);
+        return;
+    }
+    BlobInfo& obj = *found;
     int blobSide = obj.sideOfLine;
 
-    cv::Point2d ltPt(_sceneSize.width*_countingRectScale.ltScale.x, _sceneSize.height*_countingRectScale.ltScale.y);
-    cv::Point2d rbPt(_sceneSize.width*_countingRectScale.rbScale.x, _sceneSize.height*_countingRectScale.rbScale.y);
+    //多个计数线/区域
+    countZones(tracedBlob->id, obj, tracedBlob->centroid);
+
+    const cv::Point2d& ltPt = _countingLtPt;
+    const cv::Point2d& rbPt = _countingRbPt;
 
     //对象新状态不在检测区域内
     if (!isPointInRect<double>(tracedBlob->centroid.x, tracedBlob->centroid.y, ltPt.x, ltPt.y, rbPt.x, rbPt.y)) {
@@ -157,29 +444,29 @@ void BlobCounter::countTracedBlob(cvb::CvTrack* tracedBlob) {
             //判断对象运动方向,更新对象位置
             if (tracedBlobSide != SIDE_UNKNOWN && blobSide != SIDE_UNKNOWN && tracedBlobSide != blobSide) {
                 if (_lineStatus == LINE_HORIZONTAL) {
-                    double distance = fabs(tracedBlob->centroid.y - _countingLineScale.pt1Scale.y*_sceneSize.height);
+                    double distance = fabs(tracedBlob->centroid.y - _countingLinePos);
 
-                    if (distance >= _distanceThreshold*_sceneSize.height) {
+                    if (distance >= _distancePixels) {
                         //当前物件在下面，重新跟踪到时是在上面，往上，否则往下
                         if (tracedBlobSide == SIDE_TOP && blobSide == SIDE_BOTTOM) {
                             //move to top
-                            blobAcrossDetectLine(BOTTOM_MOVE_TO_TOP);
+                            blobAcrossDetectLine(BOTTOM_MOVE_TO_TOP, tracedBlob);
                         } else if (tracedBlobSide == SIDE_BOTTOM && blobSide == SIDE_TOP) {
                             //move to bottom
-                            blobAcrossDetectLine(TOP_MOVE_TO_BOTTOM);
+                            blobAcrossDetectLine(TOP_MOVE_TO_BOTTOM, tracedBlob);
                         }
                     }
                 } else {
-                    double distance = fabs(tracedBlob->centroid.x - _countingLineScale.pt1Scale.x*_sceneSize.width);
+                    double distance = fabs(tracedBlob->centroid.x - _countingLinePos);
 
-                    if (distance >= _distanceThreshold*_sceneSize.width) {
+                    if (distance >= _distancePixels) {
                         //当前物件在左侧，重新跟踪到时是在右侧，往右，否则往左
                         if (tracedBlobSide == SIDE_RIGHT && blobSide == SIDE_LEFT) {
                             //move to left
-                            blobAcrossDetectLine(LEFT_MOVE_TO_RIGHT);
+                            blobAcrossDetectLine(LEFT_MOVE_TO_RIGHT, tracedBlob);
                         } else if (tracedBlobSide == SIDE_LEFT && blobSide == SIDE_RIGHT) {
                             //move to right
-                            blobAcrossDetectLine(RIGHT_MOVE_TO_LEFT);
+                            blobAcrossDetectLine(RIGHT_MOVE_TO_LEFT, tracedBlob);
                         }
                     }
                 }
@@ -223,9 +510,14 @@ void BlobCounter::reset() {
     _iPeople = 0;
     _oPeople = 0;
 
-    _blobMap.clear();
+    clearBlobs();
     _rectInfoVec.clear();
 
+    for (size_t i = 0; i < _countingZones.size(); ++i) {
+        _countingZones[i].iPeople = 0;
+        _countingZones[i].oPeople = 0;
+    }
+
     if (_countingLineScale.pt1Scale.x == _countingLineScale.pt2Scale.x) {
         _lineStatus = LINE_VERTICAL;
     } else {
@@ -233,13 +525,24 @@ void BlobCounter::reset() {
     }
 
     _distanceThreshold = 0.0;
+
+    updateGeometry();
 }
 
 void BlobCounter::showDetectArea(cv::Mat& frame) {
-    cv::Point2d ltPt(_sceneSize.width*_countingRectScale.ltScale.x, _sceneSize.height*_countingRectScale.ltScale.y);
-    cv::Point2d rbPt(_sceneSize.width*_countingRectScale.rbScale.x, _sceneSize.height*_countingRectScale.rbScale.y);
-	cv::Rect rect(ltPt, rbPt);
+	cv::Rect rect(_countingLtPt, _countingRbPt);
 	cv::rectangle(frame, rect, cv::Scalar(0.0, 0.0, 255));
+
+    for (size_t i = 0; i < _countingZones.size(); ++i) {
+        const CountingZone& zone = _countingZones[i];
+        std::vector<cv::Point> pts;
+        for (size_t j = 0; j < zone.ptScales.size(); ++j) {
+            pts.push_back(cv::Point(cvRound(zone.ptScales[j].x*_sceneSize.width), cvRound(zone.ptScales[j].y*_sceneSize.height)));
+        }
+        if (!pts.empty()) {
+            cv::polylines(frame, pts, zone.type == ZONE_POLYGON, cv::Scalar(0.0, 255, 0));
+        }
+    }
 }
 
 void BlobCounter::showDetectLine(cv::Mat& frame) {
@@ -262,54 +565,134 @@ void BlobCounter::showDetectResult(cv::Mat& frame) {
     //if (in != _iPeople || out != _oPeople)
     {
         std::cout << "进：" << _iPeople << "  出："  << _oPeople << std::endl;
+        for (size_t i = 0; i < _countingZones.size(); ++i) {
+            std::cout << "[" << _countingZones[i].nID << "] " << _countingZones[i].label
+                      << " 进：" << _countingZones[i].iPeople << "  出：" << _countingZones[i].oPeople << std::endl;
+        }
         //in = _iPeople;
         //out = _oPeople;
     }
 }
 
-void BlobCounter::blobAcrossDetectLine(int direction) {
+void BlobCounter::blobAcrossDetectLine(int direction, const cvb::CvTrack* blob) {
+    int crossing = 0;
+
     switch (_ioDirection) {
     case IO_DIRECTION_TOP_TO_BOTTOM: {
         if (direction == BOTTOM_MOVE_TO_TOP) {
 			//onPeopleOutDetected(0);
-            ++_oPeople;
+            crossing = CROSSING_OUT;
         } else if (direction == TOP_MOVE_TO_BOTTOM) {
 			//onPeopleInDetected(0);
-            ++_iPeople;
+            crossing = CROSSING_IN;
 		}
 	}
 	break;
     case IO_DIRECTION_BOTTOM_TO_TOP: {
         if (direction == BOTTOM_MOVE_TO_TOP) {
 			//onPeopleInDetected(0);
-            ++_iPeople;
+            crossing = CROSSING_IN;
         } else if (direction == TOP_MOVE_TO_BOTTOM) {
 			//onPeopleOutDetected(0);
-            ++_oPeople;
+            crossing = CROSSING_OUT;
 		}
 	}
 	break;
     case IO_DIRECTION_LEFT_TO_RIGHT: {
         if (direction == RIGHT_MOVE_TO_LEFT) {
 			//onPeopleOutDetected(0);
-            ++_oPeople;
+            crossing = CROSSING_OUT;
         } else if (direction == LEFT_MOVE_TO_RIGHT) {
 			//onPeopleInDetected(0);
-            ++_iPeople;
+            crossing = CROSSING_IN;
 		}
 	}
 	break;
     case IO_DIRECTION_RIGHT_TO_LEFT: {
         if (direction == RIGHT_MOVE_TO_LEFT) {
 			//onPeopleInDetected(0);
-            ++_iPeople;
+            crossing = CROSSING_IN;
         } else if (direction == LEFT_MOVE_TO_RIGHT) {
 			//onPeopleOutDetected(0);
-            ++_oPeople;
+            crossing = CROSSING_OUT;
 		}
 	}
 	break;
 	default:
 		break;
 	}
+
+    if (crossing == CROSSING_IN) {
+        ++_iPeople;
+    } else if (crossing == CROSSING_OUT) {
+        ++_oPeople;
+    } else {
+        return;
+    }
+
+    emitCrossing(blob->id, CROSSING_ZONE_LINE, crossing, blob->centroid);
+}
+
+cv::Rect BlobCounter::processingRoi(int approachMargin) const {
+    double x0 = std::min(_countingLtPt.x, _countingRbPt.x);
+    double y0 = std::min(_countingLtPt.y, _countingRbPt.y);
+    double x1 = std::max(_countingLtPt.x, _countingRbPt.x);
+    double y1 = std::max(_countingLtPt.y, _countingRbPt.y);
+
+    for (size_t i = 0; i < _countingZones.size(); ++i) {
+        const std::vector<CvPoint2D64f>& pts = _countingZones[i].ptScales;
+        for (size_t j = 0; j < pts.size(); ++j) {
+            double x = pts[j].x*_sceneSize.width;
+            double y = pts[j].y*_sceneSize.height;
+            x0 = std::min(x0, x);
+            y0 = std::min(y0, y);
+            x1 = std::max(x1, x);
+            y1 = std::max(y1, y);
+        }
+    }
+
+    cv::Rect roi(cvFloor(x0) - approachMargin,
+                 cvFloor(y0) - approachMargin,
+                 cvCeil(x1) - cvFloor(x0) + 2*approachMargin,
+                 cvCeil(y1) - cvFloor(y0) + 2*approachMargin);
+
+    return roi & cv::Rect(0, 0, _sceneSize.width, _sceneSize.height);
+}
+
+double BlobCounter::distanceToZones(const CvPoint2D64f& pt) const {
+    //检测线只在检测区内有效
+    CvPoint2D64f lineStart, lineEnd;
+    if (_lineStatus == LINE_VERTICAL) {
+        lineStart = cvPoint2D64f(_countingLinePos, _countingLtPt.y);
+        lineEnd = cvPoint2D64f(_countingLinePos, _countingRbPt.y);
+    } else {
+        lineStart = cvPoint2D64f(_countingLtPt.x, _countingLinePos);
+        lineEnd = cvPoint2D64f(_countingRbPt.x, _countingLinePos);
+    }
+    double distance = distanceToSegment(pt, lineStart, lineEnd);
+
+    for (size_t e = 0; e < _zoneEdges.size(); ++e) {
+        distance = std::min(distance, distanceToSegment(pt, _zoneEdges[e].pt1, _zoneEdges[e].pt2));
+    }
+
+    return distance;
+}
+
+void BlobCounter::setEventStream(CrossingEventStream* events) {
+    _events = events;
+}
+
+void BlobCounter::emitCrossing(int trackId, int zone, int direction, const CvPoint2D64f& centroid) {
+    if (!_events) {
+        return;
+    }
+
+    CrossingEvent ev;
+    ev.timestamp = CrossingEventStream::now();
+    ev.trackId = trackId;
+    ev.zone = zone;
+    ev.direction = direction;
+    ev.x = (float)centroid.x;
+    ev.y = (float)centroid.y;
+    _events->publish(ev);
 }
@@ -20,6 +20,7 @@
 #include "opencv2/core.hpp"
 #include "cvBlob/cvblob.h"
 
+class CrossingEventStream;
 
 //统计进出门数量定义
 #define SIDE_UNKNOWN                   0	//无效位置信息
@@ -41,6 +42,14 @@
 #define IO_DIRECTION_LEFT_TO_RIGHT     3	//进门方向：从左往右
 #define IO_DIRECTION_RIGHT_TO_LEFT     4	//进门方向：从右往左
 
+#define ZONE_LINE                      1	//计数线（可为折线）
+#define ZONE_POLYGON                   2	//计数区域（多边形）
+
+#define ZONE_IN_LEFT                   1	//线：从有向线段右侧穿到左侧为进；多边形：进入为进
+#define ZONE_IN_RIGHT                  2	//与 ZONE_IN_LEFT 相反
+
+#define ZONE_CELL_SIZE                 16	//计数区域空间索引的网格大小（像素）
+
 #ifndef _BLOB_INFO_
 #define _BLOB_INFO_
 typedef struct BlobInfo
@@ -54,6 +63,8 @@ typedef struct BlobInfo
 
     unsigned int sideOfLine;         //物件在检测线的哪一侧:Left/Right/Top/Bottom
     unsigned int isInRect;           //1 : in, 0 : out
+
+    CvPoint2D64f zoneCentroid;       //最近一次不在任何计数线滞回带内的质心
 } BlobInfo;
 #endif
 
@@ -86,6 +97,20 @@ typedef struct RectInfo
 } RectInfo;
 #endif
 
+#ifndef _COUNTING_ZONE_
+#define _COUNTING_ZONE_
+typedef struct CountingZone
+{
+    int nID;
+    std::string label;
+    int type;                              //ZONE_LINE/ZONE_POLYGON
+    std::vector<CvPoint2D64f> ptScales;    //顶点（相对画面宽高的比例）
+    int inSide;                            //ZONE_IN_LEFT/ZONE_IN_RIGHT
+    int iPeople;
+    int oPeople;
+} CountingZone;
+#endif
+
 class ICounter {
 public:
     //新出现物件信号
@@ -113,6 +138,25 @@ public:
     //重新初始化计数器
     void reset();
 
+    //增加计数线/区域，返回其编号；可以有多个，各自计数
+    int addCountingZone(const CountingZone& zone);
+    void clearCountingZones();
+    const std::vector<CountingZone>& countingZones() const { return _countingZones; }
+
+    //质心离计数线小于该距离（像素）时不做穿越判断，防止在线附近晃动造成重复计数
+    void setZoneHysteresis(double distance);
+
+    //每次计数时向事件流发布一条 CrossingEvent，传 NULL 关闭
+    void setEventStream(CrossingEventStream* events);
+
+    //处理区域：检测区与所有计数线/区域的外接矩形，向外扩 approachMargin 像素（供轨迹在进入检测区前建立），
+    //裁剪到画面内。采集、分层、标记、跟踪只需在该区域内进行。
+    //与区域边缘相交的团块会被丢弃，approachMargin 至少要有一个头部的宽度
+    cv::Rect processingRoi(int approachMargin) const;
+
+    //点到检测线及所有计数线/区域边的最近距离（像素）
+    double distanceToZones(const CvPoint2D64f& pt) const;
+
     void showDetectArea(cv::Mat& frame);
     void showDetectLine(cv::Mat& frame);
     void showDetectResult(cv::Mat& frame);
@@ -128,7 +172,25 @@ protected:
     void countTracedBlob(cvb::CvTrack* tracedBlob);
 
     //运动物件跨线信号
-    void blobAcrossDetectLine(int direction);
+    void blobAcrossDetectLine(int direction, const cvb::CvTrack* blob);
+
+    //发布计数事件
+    void emitCrossing(int trackId, int zone, int direction, const CvPoint2D64f& centroid);
+
+    //把计数线/区域的边编译成网格索引
+    void compileZones();
+
+    //用物件上一稳定质心到当前质心的线段判断穿越了哪些计数线/区域
+    void countZones(int trackId, BlobInfo& obj, const CvPoint2D64f& centroid);
+
+    //由比例计算检测区、检测线的像素坐标，只在 init()/reset() 时做一次
+    void updateGeometry();
+
+    //物件信息表操作
+    BlobInfo* findBlob(int id);
+    BlobInfo& insertBlob(int id);
+    void eraseBlob(int id);
+    void clearBlobs();
 
 public:
     //新出现物件信号
@@ -141,7 +203,15 @@ public:
     void blobDisappear(cvb::CvTrack* blob);
 
 private:
-    std::map<int, BlobInfo> _blobMap;       //跟踪到的物件信息
+    typedef struct BlobSlot
+    {
+        int id;
+        bool used;
+        BlobInfo info;
+    } BlobSlot;
+
+    std::vector<BlobSlot> _blobSlots;       //跟踪到的物件信息，按跟踪 ID 线性探测的开放寻址表
+    size_t _blobCount;
     LineScale _countingLineScale;           //检测线
     RectScale _countingRectScale;           //检测区
     int _lineStatus;                        //检测线方向：1水平/2垂直
@@ -150,6 +220,29 @@ private:
     cv::Size _sceneSize;
     int _ioDirection;
 
+    cv::Point2d _countingLtPt;              //检测区左上角（像素）
+    cv::Point2d _countingRbPt;              //检测区右下角（像素）
+    double _countingLinePos;                //检测线位置（像素）：水平线为 y，垂直线为 x
+    double _distancePixels;                 //过线距离阈值（像素）
+
+    typedef struct ZoneEdge
+    {
+        int zone;                           //所属计数线/区域
+        CvPoint2D64f pt1;                   //像素坐标
+        CvPoint2D64f pt2;
+    } ZoneEdge;
+
+    std::vector<CountingZone> _countingZones;   //计数线/区域
+    std::vector<ZoneEdge> _zoneEdges;           //所有计数线/区域的边
+    std::vector<std::vector<int> > _zoneGrid;   //网格 -> 经过（含滞回带）该格的边
+    std::vector<unsigned int> _edgeStamp;       //单次判断中边的去重标记
+    unsigned int _stamp;
+    int _gridCols;
+    int _gridRows;
+    double _zoneHysteresis;
+
+    CrossingEventStream* _events;           //计数事件流，可为空
+
 public:
     int _iPeople;
     int _oPeople;
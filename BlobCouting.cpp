@@ -1,18 +1,25 @@
 ﻿#include "BlobCouting.h"
 
-namespace FAV1
+BlobCouting::BlobCouting(const std::string &name, const std::string &config):
+    firstTime(true), configLoaded(false), showOutput(true), key(0), laneOrientation(LO_NONE), countAB(0), countBA(0), img_w(0), img_h(0), showAB(0),
+    windowName(name), configFile(config), img_input1(0), roi_x0(0), roi_y0(0), roi_x1(0), roi_y1(0), startDraw(0), roi_defined(false), use_roi(true)
 {
-IplImage* img_input1 = 0;
-IplImage* img_input2 = 0;
-int roi_x0 = 0;
-int roi_y0 = 0;
-int roi_x1 = 0;
-int roi_y1 = 0;
-int numOfRec = 0;
-int startDraw = 0;
-bool roi_defined = false;
-bool use_roi = true;
-void BlobCouting_on_mouse(int evt, int x, int y, int flag, void* param)
+    std::cout << "BlobCouting()" << std::endl;
+}
+
+BlobCouting::~BlobCouting()
+{
+    std::cout << "~BlobCouting()" << std::endl;
+}
+
+void BlobCouting::on_mouse(int evt, int x, int y, int flag, void* param)
+{
+    BlobCouting* self = static_cast<BlobCouting*>(param);
+    if(self)
+        self->mouseEvent(evt, x, y);
+}
+
+void BlobCouting::mouseEvent(int evt, int x, int y)
 {
     if(!use_roi)
         return;
@@ -34,25 +41,19 @@ void BlobCouting_on_mouse(int evt, int x, int y, int flag, void* param)
         }
     }
 
-    if(evt == CV_EVENT_MOUSEMOVE && startDraw)
+    if(evt == CV_EVENT_MOUSEMOVE && startDraw && img_input1)
     {
         //redraw ROI selection
-        img_input2 = cvCloneImage(img_input1);
+        IplImage* img_input2 = cvCloneImage(img_input1);
         cvLine(img_input2, cvPoint(roi_x0,roi_y0), cvPoint(x,y), CV_RGB(255,0,255));
-        cvShowImage("BlobCouting", img_input2);
+        cvShowImage(windowName.c_str(), img_input2);
         cvReleaseImage(&img_input2);
     }
 }
-}
 
-BlobCouting::BlobCouting(): firstTime(true), showOutput(true), key(0), countAB(0), countBA(0), showAB(0)
+void BlobCouting::reloadConfig()
 {
-    std::cout << "BlobCouting()" << std::endl;
-}
-
-BlobCouting::~BlobCouting()
-{
-    std::cout << "~BlobCouting()" << std::endl;
+    loadConfig();
 }
 
 void BlobCouting::setInput(const cv::Mat &i)
@@ -72,13 +73,13 @@ BlobPosition BlobCouting::getBlobPosition(const CvPoint2D64f centroid)
 
     if(laneOrientation == LO_HORIZONTAL)
     {
-        if(centroid.x < FAV1::roi_x0)
+        if(centroid.x < roi_x0)
         {
             cv::putText(img_input, "STATE: A", cv::Point(10,img_h/2), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255,255,255));
             BlobPosition = VP_A;
         }
 
-        if(centroid.x > FAV1::roi_x0)
+        if(centroid.x > roi_x0)
         {
             cv::putText(img_input, "STATE: B", cv::Point(10,img_h/2), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255,255,255));
             BlobPosition = VP_B;
@@ -87,13 +88,13 @@ BlobPosition BlobCouting::getBlobPosition(const CvPoint2D64f centroid)
 
     if(laneOrientation == LO_VERTICAL)
     {
-        if(centroid.y > FAV1::roi_y0)
+        if(centroid.y > roi_y0)
         {
             cv::putText(img_input, "STATE: A", cv::Point(10,img_h/2), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255,255,255));
             BlobPosition = VP_A;
         }
 
-        if(centroid.y < FAV1::roi_y0)
+        if(centroid.y < roi_y0)
         {
             cv::putText(img_input, "STATE: B", cv::Point(10,img_h/2), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255,255,255));
             BlobPosition = VP_B;
@@ -111,24 +112,26 @@ void BlobCouting::process()
     img_w = img_input.size().width;
     img_h = img_input.size().height;
 
-    loadConfig();
+    if(!configLoaded)
+        loadConfig();
 
     //--------------------------------------------------------------------------
 
-    if(FAV1::use_roi == true && FAV1::roi_defined == false && firstTime == true)
+    if(use_roi == true && roi_defined == false && firstTime == true)
     {
         do
         {
             cv::putText(img_input, "Please, set the counting line", cv::Point(10,15), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(0,0,255));
-            cv::imshow("BlobCouting", img_input);
-            FAV1::img_input1 = new IplImage(img_input);
-            cvSetMouseCallback("BlobCouting", FAV1::BlobCouting_on_mouse, NULL);
+            cv::imshow(windowName, img_input);
+            img_input1 = new IplImage(img_input);
+            cvSetMouseCallback(windowName.c_str(), BlobCouting::on_mouse, this);
             key = cvWaitKey(0);
-            delete FAV1::img_input1;
+            delete img_input1;
+            img_input1 = 0;
 
-            if(FAV1::roi_defined)
+            if(roi_defined)
             {
-                std::cout << "Counting line defined (" << FAV1::roi_x0 << "," << FAV1::roi_y0 << "," << FAV1::roi_x1 << "," << FAV1::roi_y1 << ")" << std::endl;
+                std::cout << "Counting line defined (" << roi_x0 << "," << roi_y0 << "," << roi_x1 << "," << roi_y1 << ")" << std::endl;
                 break;
             }
             else
@@ -136,36 +139,36 @@ void BlobCouting::process()
         }while(1);
     }
 
-    if(FAV1::use_roi == true && FAV1::roi_defined == true)
-        cv::line(img_input, cv::Point(FAV1::roi_x0,FAV1::roi_y0), cv::Point(FAV1::roi_x1,FAV1::roi_y1), cv::Scalar(0,0,255));
+    if(use_roi == true && roi_defined == true)
+        cv::line(img_input, cv::Point(roi_x0,roi_y0), cv::Point(roi_x1,roi_y1), cv::Scalar(0,0,255));
 
     bool ROI_OK = false;
 
-    if(FAV1::use_roi == true && FAV1::roi_defined == true)
+    if(use_roi == true && roi_defined == true)
         ROI_OK = true;
 
     if(ROI_OK)
     {
         laneOrientation = LO_NONE;
 
-        if(abs(FAV1::roi_x0 - FAV1::roi_x1) < abs(FAV1::roi_y0 - FAV1::roi_y1))
+        if(abs(roi_x0 - roi_x1) < abs(roi_y0 - roi_y1))
         {
             if(!firstTime)
                 cv::putText(img_input, "HORIZONTAL", cv::Point(10,15), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255,255,255));
             laneOrientation = LO_HORIZONTAL;
 
-            cv::putText(img_input, "(A)", cv::Point(FAV1::roi_x0-32,FAV1::roi_y0), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255,255,255));
-            cv::putText(img_input, "(B)", cv::Point(FAV1::roi_x0+12,FAV1::roi_y0), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255,255,255));
+            cv::putText(img_input, "(A)", cv::Point(roi_x0-32,roi_y0), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255,255,255));
+            cv::putText(img_input, "(B)", cv::Point(roi_x0+12,roi_y0), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255,255,255));
         }
 
-        if(abs(FAV1::roi_x0 - FAV1::roi_x1) > abs(FAV1::roi_y0 - FAV1::roi_y1))
+        if(abs(roi_x0 - roi_x1) > abs(roi_y0 - roi_y1))
         {
             if(!firstTime)
                 cv::putText(img_input, "VERTICAL", cv::Point(10,15), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255,255,255));
             laneOrientation = LO_VERTICAL;
 
-            cv::putText(img_input, "(A)", cv::Point(FAV1::roi_x0,FAV1::roi_y0+22), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255,255,255));
-            cv::putText(img_input, "(B)", cv::Point(FAV1::roi_x0,FAV1::roi_y0-12), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255,255,255));
+            cv::putText(img_input, "(A)", cv::Point(roi_x0,roi_y0+22), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255,255,255));
+            cv::putText(img_input, "(B)", cv::Point(roi_x0,roi_y0-12), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255,255,255));
         }
     }
 
@@ -224,47 +227,24 @@ void BlobCouting::process()
 
         //----------------------------------------------------------------------------
 
-        if(points.count(id) > 0)
+        if(track->inactive == 0)
         {
-            std::map<cvb::CvID, std::vector<CvPoint2D64f>>::iterator it2 = points.find(id);
-            std::vector<CvPoint2D64f> centroids = it2->second;
-
-            std::vector<CvPoint2D64f> centroids2;
-            if(track->inactive == 0 && centroids.size() < 30)
-            {
-                centroids2.push_back(centroid);
-
-                for(std::vector<CvPoint2D64f>::iterator it3 = centroids.begin() ; it3 != centroids.end(); it3++)
-                {
-                    centroids2.push_back(*it3);
-                }
-
-                for(std::vector<CvPoint2D64f>::iterator it3 = centroids2.begin() ; it3 != centroids2.end(); it3++)
-                {
-                    cv::circle(img_input, cv::Point((*it3).x,(*it3).y), 3, cv::Scalar(255,255,255), -1);
-                }
+            trajectories.append(id, centroid);
 
-                points.erase(it2);
-                points.insert(std::pair<cvb::CvID, std::vector<CvPoint2D64f>>(id,centroids2));
-            }
-            else
-            {
-                points.erase(it2);
-            }
+            TrajectoryView history = trajectories.view(id);
+            for(int k = 0; k < history.size(); k++)
+                cv::circle(img_input, cv::Point(history[k].x,history[k].y), 3, cv::Scalar(255,255,255), -1);
         }
         else
         {
-            if(track->inactive == 0)
-            {
-                std::vector<CvPoint2D64f> centroids;
-                centroids.push_back(centroid);
-                points.insert(std::pair<cvb::CvID, std::vector<CvPoint2D64f>>(id,centroids));
-            }
+            trajectories.remove(id);
         }
 
         //cv::waitKey(0);
     }
 
+    trajectories.prune(tracks);
+
     //--------------------------------------------------------------------------
 
     std::string countABstr = "A->B: " + std::to_string(countAB);
@@ -283,7 +263,7 @@ void BlobCouting::process()
         cv::putText(img_input, countBAstr, cv::Point(10, img_h - 8), cv::FONT_HERSHEY_PLAIN, 1, cv::Scalar(255, 255, 255));
 
     if(showOutput)
-        cv::imshow("BlobCouting", img_input);
+        cv::imshow(windowName, img_input);
 
     if(firstTime)
         saveConfig();
@@ -293,34 +273,36 @@ void BlobCouting::process()
 
 void BlobCouting::saveConfig()
 {
-    CvFileStorage* fs = cvOpenFileStorage("config/BlobCouting.xml", 0, CV_STORAGE_WRITE);
+    CvFileStorage* fs = cvOpenFileStorage(configFile.c_str(), 0, CV_STORAGE_WRITE);
 
     cvWriteInt(fs, "showOutput", showOutput);
     cvWriteInt(fs, "showAB", showAB);
 
-    cvWriteInt(fs, "fav1_use_roi", FAV1::use_roi);
-    cvWriteInt(fs, "fav1_roi_defined", FAV1::roi_defined);
-    cvWriteInt(fs, "fav1_roi_x0", FAV1::roi_x0);
-    cvWriteInt(fs, "fav1_roi_y0", FAV1::roi_y0);
-    cvWriteInt(fs, "fav1_roi_x1", FAV1::roi_x1);
-    cvWriteInt(fs, "fav1_roi_y1", FAV1::roi_y1);
+    cvWriteInt(fs, "fav1_use_roi", use_roi);
+    cvWriteInt(fs, "fav1_roi_defined", roi_defined);
+    cvWriteInt(fs, "fav1_roi_x0", roi_x0);
+    cvWriteInt(fs, "fav1_roi_y0", roi_y0);
+    cvWriteInt(fs, "fav1_roi_x1", roi_x1);
+    cvWriteInt(fs, "fav1_roi_y1", roi_y1);
 
     cvReleaseFileStorage(&fs);
 }
 
 void BlobCouting::loadConfig()
 {
-    CvFileStorage* fs = cvOpenFileStorage("config/BlobCouting.xml", 0, CV_STORAGE_READ);
+    CvFileStorage* fs = cvOpenFileStorage(configFile.c_str(), 0, CV_STORAGE_READ);
 
     showOutput = cvReadIntByName(fs, 0, "showOutput", true);
     showAB = cvReadIntByName(fs, 0, "showAB", 1);
 
-    FAV1::use_roi = cvReadIntByName(fs, 0, "fav1_use_roi", true);
-    FAV1::roi_defined = cvReadIntByName(fs, 0, "fav1_roi_defined", false);
-    FAV1::roi_x0 = cvReadIntByName(fs, 0, "fav1_roi_x0", 0);
-    FAV1::roi_y0 = cvReadIntByName(fs, 0, "fav1_roi_y0", 0);
-    FAV1::roi_x1 = cvReadIntByName(fs, 0, "fav1_roi_x1", 0);
-    FAV1::roi_y1 = cvReadIntByName(fs, 0, "fav1_roi_y1", 0);
+    use_roi = cvReadIntByName(fs, 0, "fav1_use_roi", true);
+    roi_defined = cvReadIntByName(fs, 0, "fav1_roi_defined", false);
+    roi_x0 = cvReadIntByName(fs, 0, "fav1_roi_x0", 0);
+    roi_y0 = cvReadIntByName(fs, 0, "fav1_roi_y0", 0);
+    roi_x1 = cvReadIntByName(fs, 0, "fav1_roi_x1", 0);
+    roi_y1 = cvReadIntByName(fs, 0, "fav1_roi_y1", 0);
 
     cvReleaseFileStorage(&fs);
+
+    configLoaded = true;
 }
@@ -5,6 +5,7 @@
 #include <opencv2/opencv.hpp>
 
 #include "cvBlob/cvblob.h"
+#include "TrajectoryStore.h"
 
 enum LaneOrientation
 {
@@ -24,11 +25,12 @@ class BlobCouting
 {
 private:
     bool firstTime;
+    bool configLoaded;
     bool showOutput;
     int key;
     cv::Mat img_input;
     cvb::CvTracks tracks;
-    std::map<cvb::CvID, std::vector<CvPoint2D64f> > points;
+    TrajectoryStore trajectories;
     LaneOrientation laneOrientation;
     std::map<cvb::CvID, BlobPosition> positions;
     long countAB;
@@ -37,17 +39,36 @@ private:
     int img_h;
     int showAB;
 
+    std::string windowName;
+    std::string configFile;
+
+    // counting line, set from the config or with the mouse
+    IplImage* img_input1;
+    int roi_x0;
+    int roi_y0;
+    int roi_x1;
+    int roi_y1;
+    int startDraw;
+    bool roi_defined;
+    bool use_roi;
+
 public:
-    BlobCouting();
+    BlobCouting(const std::string &name = "BlobCouting", const std::string &config = "config/BlobCouting.xml");
     ~BlobCouting();
 
     void setInput(const cv::Mat &i);
     void setTracks(const cvb::CvTracks &t);
     void process();
 
+    // the config is read on the first process(); call this to pick up edits
+    void reloadConfig();
+
 private:
     BlobPosition getBlobPosition(const CvPoint2D64f centroid);
 
+    static void on_mouse(int evt, int x, int y, int flag, void* param);
+    void mouseEvent(int evt, int x, int y);
+
     void saveConfig();
     void loadConfig();
 };
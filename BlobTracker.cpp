@@ -3,6 +3,8 @@
 #include "opencv2/core.hpp"
 #include "opencv2/imgproc.hpp"
 #include "opencv2/highgui.hpp"
+#include "FramePool.h"
+#include <algorithm>
 
 BlobTracker::BlobTracker(ICounter* counter) : _counter(counter) {
     _processScale = 1.0f;
@@ -16,6 +18,11 @@ BlobTracker::BlobTracker(ICounter* counter) : _counter(counter) {
     cvReleaseTracks(_trackers);
 
     _label = NULL;
+    _stagePixels = NULL;
+    _frameNo = 0;
+    _lastProcessed = 0;
+
+    FramePool::instance().adopt(_drawer);
 }
 
 
@@ -40,12 +47,18 @@ void BlobTracker::init(float processScale,
     _blobMaxScale = maxScale;
     _blobNo = 0;
     _isInited = false;
+    _frameNo = 0;
+    _lastProcessed = 0;
+    _gaps.clear();
     cvReleaseTracks(_trackers);
 }
 
 void BlobTracker::reset() {
     _blobNo = 0;
     _isInited = false;
+    _frameNo = 0;
+    _lastProcessed = 0;
+    _gaps.clear();
 
     if (_label) {
         cvReleaseImage(&_label);
@@ -55,6 +68,53 @@ void BlobTracker::reset() {
     cvReleaseTracks(_trackers);
 }
 
+void BlobTracker::setProcessingRoi(const cv::Rect& roi) {
+    _processingRoi = roi;
+
+    // cvLabel only clears the ROI, labels outside an old one must not stay
+    if (_label) {
+        cvZero(_label);
+    }
+}
+
+void BlobTracker::setStagePixels(StagePixels* stats) {
+    _stagePixels = stats;
+}
+
+void BlobTracker::skipFrame() {
+    ++_frameNo;
+}
+
+void BlobTracker::offsetBlobs(cvb::CvBlobs& blobs, const cv::Point& offset) {
+    double ox = offset.x;
+    double oy = offset.y;
+    for (cvb::CvBlobs::iterator it = blobs.begin(); it != blobs.end(); ++it) {
+        cvb::CvBlob* blob = it->second;
+        double area = blob->area;
+
+        blob->minx += offset.x;
+        blob->maxx += offset.x;
+        blob->miny += offset.y;
+        blob->maxy += offset.y;
+        blob->centroid.x += ox;
+        blob->centroid.y += oy;
+
+        // raw moments, the central ones do not move
+        blob->m11 += oy*blob->m10 + ox*blob->m01 + ox*oy*area;
+        blob->m20 += 2*ox*blob->m10 + ox*ox*area;
+        blob->m02 += 2*oy*blob->m01 + oy*oy*area;
+        blob->m10 += ox*area;
+        blob->m01 += oy*area;
+
+        blob->contour.startingPoint.x += offset.x;
+        blob->contour.startingPoint.y += offset.y;
+        for (cvb::CvContoursChainCode::iterator jt = blob->internalContours.begin(); jt != blob->internalContours.end(); ++jt) {
+            (*jt)->startingPoint.x += offset.x;
+            (*jt)->startingPoint.y += offset.y;
+        }
+    }
+}
+
 void BlobTracker::process(const cv::Mat& frame) {
     if (!_isInited) {
         if (_label) {
@@ -63,6 +123,7 @@ void BlobTracker::process(const cv::Mat& frame) {
         }
 
         _label = cvCreateImage(cvSize(frame.cols, frame.rows), IPL_DEPTH_LABEL, 1);
+        cvZero(_label);
 
         _isInited = true;
     }
@@ -84,16 +145,24 @@ void BlobTracker::process(const cv::Mat& frame) {
     //    cv::Mat headFrame;
     //    m_headExtraction.ExtractHead(tmpFrame, headFrame);
     //    //return;
-    cv::Mat src;
-    src = frame;
     IplImage foreground = frame;
-    cv::cvtColor(frame, src, CV_GRAY2BGR);
-    IplImage drawer = src;
+    cv::cvtColor(frame, _drawer, CV_GRAY2BGR);
+    IplImage drawer = _drawer;
 
-    cvZero(_label);
+    cv::Rect full(0, 0, frame.cols, frame.rows);
+    cv::Rect roi = _processingRoi.area() > 0 ? _processingRoi & full : full;
 
+    // cvLabel clears and labels only the ROI of _label
     cvb::CvBlobs blobs;
+    cvSetImageROI(&foreground, roi);
+    cvSetImageROI(_label, roi);
     unsigned int result = cvLabel(&foreground, _label, blobs);
+    cvResetImageROI(_label);
+    offsetBlobs(blobs, roi.tl());
+
+    if (_stagePixels) {
+        _stagePixels->tracking += roi.area();
+    }
 
     //qDebug("result = %d", result);
     //    uint64 nArea = headFrame.rows * headFrame.cols;
@@ -119,15 +188,82 @@ void BlobTracker::process(const cv::Mat& frame) {
     cvb::cvReleaseBlobs(blobs);
 }
 
+void BlobTracker::process(const std::vector<Detection>& detections) {
+    process(detections.empty() ? NULL : &detections[0], detections.size());
+}
+
+void BlobTracker::process(const Detection* detections, size_t count) {
+    _detectionBlobs.resize(count);
+
+    cvb::CvBlobs blobs;
+    for (size_t i = 0; i < count; ++i) {
+        const Detection& det = detections[i];
+        cvb::CvBlob& blob = _detectionBlobs[i];
+
+        blob.label = (cvb::CvLabel)(i + 1);
+        blob.area = (unsigned int)cvRound(det.area);
+        blob.minx = det.bbox.x;
+        blob.miny = det.bbox.y;
+        blob.maxx = det.bbox.x + det.bbox.width - 1;
+        blob.maxy = det.bbox.y + det.bbox.height - 1;
+        blob.centroid = cvPoint2D64f(det.centroid.x, det.centroid.y);
+        blob.m10 = det.centroid.x*det.area;
+        blob.m01 = det.centroid.y*det.area;
+        blob.depthCount = 0;
+
+        blobs.insert(cvb::CvLabelBlob(blob.label, &blob));
+    }
+
+    updateTrackers(blobs);
+}
+
+void BlobTracker::predictedRegions(std::vector<cv::Rect>& regions, int framesAhead) const {
+    regions.clear();
+
+    int pad = cvCeil(_distance);
+    for (cvb::CvTracks::const_iterator it = _trackers.begin(); it != _trackers.end(); ++it) {
+        const cvb::CvTrack* track = it->second;
+        // constant velocity from the last two positions
+        CvPoint2D64f v;
+        _gaps.velocity(track->id, v);
+        int dx = cvRound(v.x * framesAhead);
+        int dy = cvRound(v.y * framesAhead);
+        cv::Rect rc((int)track->minx + dx - pad,
+                    (int)track->miny + dy - pad,
+                    (int)(track->maxx - track->minx) + 1 + 2*pad,
+                    (int)(track->maxy - track->miny) + 1 + 2*pad);
+        regions.push_back(rc);
+    }
+}
+
 void BlobTracker::blobAppear(cvb::CvTrack* blob) {
+    _gaps.add(blob->id, _frameNo, blob->centroid);
     _counter->blobAppear(blob);
 }
 
 void BlobTracker::blobTraced(cvb::CvTrack* blob) {
+    _gaps.add(blob->id, _frameNo, blob->centroid);
+    _gaps.fill(blob->id, _gapPoints);
+    if (!_gapPoints.empty()) {
+        // the counter sees the skipped frames first, the box moves with the centroid
+        cvb::CvTrack actual = *blob;
+        for (size_t i = 0; i < _gapPoints.size(); ++i) {
+            double dx = _gapPoints[i].x - actual.centroid.x;
+            double dy = _gapPoints[i].y - actual.centroid.y;
+            blob->centroid = _gapPoints[i];
+            blob->minx = (unsigned int)std::max(0.0, actual.minx + dx);
+            blob->maxx = (unsigned int)std::max(0.0, actual.maxx + dx);
+            blob->miny = (unsigned int)std::max(0.0, actual.miny + dy);
+            blob->maxy = (unsigned int)std::max(0.0, actual.maxy + dy);
+            _counter->blobTraced(blob);
+        }
+        *blob = actual;
+    }
     _counter->blobTraced(blob);
 }
 
 void BlobTracker::blobDisappear(cvb::CvTrack* blob) {
+    _gaps.remove(blob->id);
     _counter->blobDisappear(blob);
 }
 
@@ -135,6 +271,13 @@ void BlobTracker::updateTrackers(const cvb::CvBlobs& blobs) {
     CV_FUNCNAME("cvUpdateTrackers");
     __CV_BEGIN__;
 
+    ++_frameNo;
+
+    // After skipped frames a track may have moved that many times as far
+    unsigned int elapsed = std::max(_frameNo - _lastProcessed, 1u);
+    _lastProcessed = _frameNo;
+    double distance = _distance * elapsed;
+
     unsigned int nBlobs = blobs.size();
     unsigned int nTracks = _trackers.size();
 
@@ -168,7 +311,7 @@ void BlobTracker::updateTrackers(const cvb::CvBlobs& blobs) {
         // Proximity matrix calculation and "used blob" list inicialization:
         for (i = 0; i<nBlobs; i++) {
             for (j = 0; j<nTracks; j++) {
-                if (close[((i)+(j)*(nBlobs + 2))] = (cvb::distantBlobTrack(blobs.find(close[((i)+(nTracks + 1)*(nBlobs + 2))])->second, _trackers.find(close[(((nBlobs)+1) + (j)*(nBlobs + 2))])->second) < _distance)) {
+                if (close[((i)+(j)*(nBlobs + 2))] = (cvb::distantBlobTrack(blobs.find(close[((i)+(nTracks + 1)*(nBlobs + 2))])->second, _trackers.find(close[(((nBlobs)+1) + (j)*(nBlobs + 2))])->second) < distance)) {
                     //AB(i)++;
                     close[((i)+(nTracks)*(nBlobs + 2))]++;
                     //AT(j)++;
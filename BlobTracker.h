@@ -3,6 +3,9 @@
 #include "opencv2/core.hpp"
 #include "cvBlob/cvblob.h"
 #include "BlobCounter.h"
+#include "Detection.h"
+#include "StagePixels.h"
+#include "TrackGapFiller.h"
 
 class BlobTracker {
 public:
@@ -20,6 +23,32 @@ public:
 
     void process(const cv::Mat& frame);
 
+    // process(frame) only labels the mask inside roi (frame coordinates),
+    // usually BlobCounter::processingRoi(); blobs keep frame coordinates.
+    // An empty rect (the default) means the whole frame.
+    void setProcessingRoi(const cv::Rect& roi);
+
+    // Pixels labelled by process(frame) go to stats->tracking, NULL to stop.
+    void setStagePixels(StagePixels* stats);
+
+    // The current frame is not processed (see FrameScheduler). When a track is
+    // matched again after skipped frames, the counter is first handed the
+    // positions TrackGapFiller interpolates for them, so it sees the track
+    // move frame by frame. Inactive counts only advance on processed frames.
+    // The match distance is scaled by the frames since the last processed one.
+    void skipFrame();
+
+    const cvb::CvTracks& tracks() const { return _trackers; }
+
+    // Track blobs handed over by IExtracter::detects(); no mask, no relabelling.
+    void process(const std::vector<Detection>& detections);
+    void process(const Detection* detections, size_t count);
+
+    // Bounding boxes of the current tracks moved framesAhead frames along
+    // their last velocity and grown by the max match distance, i.e. where
+    // each tracked blob can show up in the next processed frame.
+    void predictedRegions(std::vector<cv::Rect>& regions, int framesAhead = 1) const;
+
 protected:
     void blobAppear(cvb::CvTrack* blob);
 
@@ -29,13 +58,31 @@ protected:
 
     void updateTrackers(const cvb::CvBlobs& blobs);
 
+    // Moves blobs labelled inside a ROI to frame coordinates.
+    static void offsetBlobs(cvb::CvBlobs& blobs, const cv::Point& offset);
+
 private:
     float _processScale;
 
     IplImage* _label;
+    //Colour copy of the frame the blobs are rendered on.
+    cv::Mat _drawer;
     cvb::CvTracks _trackers;
 
-    //Max distance to determine when a track and a blob match.
+    cv::Rect _processingRoi;
+    StagePixels* _stagePixels;
+
+    //Frame number, processed and skipped frames alike.
+    unsigned int _frameNo;
+    //Frame number of the last processed frame.
+    unsigned int _lastProcessed;
+    TrackGapFiller _gaps;
+    std::vector<CvPoint2D64f> _gapPoints;
+
+    //Blobs built from the detections, reused from frame to frame.
+    std::vector<cvb::CvBlob> _detectionBlobs;
+
+    //Max distance to determine when a track and a blob match, per frame since the last processed one.
     double _distance;
 
     //Max number of frames a track can be inactive.
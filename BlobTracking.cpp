@@ -1,15 +1,28 @@
 #include "BlobTracking.h"
 
-BlobTracking::BlobTracking() : firstTime(true), minArea(500), maxArea(20000), debugTrack(false), debugBlob(false), showBlobMask(false), showOutput(true)
+BlobTracking::BlobTracking(const std::string &config) : firstTime(true), configLoaded(false), configFile(config), minArea(500), maxArea(20000), debugTrack(false), debugBlob(false), showBlobMask(false), showOutput(false), renderOutput(false), labelImg(0)
 {
     std::cout << "BlobTracking()" << std::endl;
 }
 
 BlobTracking::~BlobTracking()
 {
+    if(labelImg)
+        cvReleaseImage(&labelImg);
+
     std::cout << "~BlobTracking()" << std::endl;
 }
 
+void BlobTracking::reloadConfig()
+{
+    loadConfig();
+}
+
+void BlobTracking::setRenderOutput(bool render)
+{
+    renderOutput = render;
+}
+
 const cvb::CvTracks BlobTracking::getTracks()
 {
     return tracks;
@@ -20,65 +33,69 @@ void BlobTracking::process(const cv::Mat &img_input, const cv::Mat &img_mask, cv
     if(img_input.empty() || img_mask.empty())
         return;
 
-    loadConfig();
+    if(!configLoaded)
+        loadConfig();
 
     if(firstTime)
         saveConfig();
 
-    IplImage* frame = new IplImage(img_input);
-    cvConvertScale(frame, frame, 1, 0);
+    // buffers are kept between frames and only reallocated when the size changes
+    if(morphKernel.empty())
+        morphKernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(5, 5), cv::Point(1, 1));
 
-    IplImage* segmentated = new IplImage(img_mask);
-
-    IplConvKernel* morphKernel = cvCreateStructuringElementEx(5, 5, 1, 1, CV_SHAPE_RECT, NULL);
-    cvMorphologyEx(segmentated, segmentated, NULL, morphKernel, CV_MOP_OPEN, 1);
+    cv::morphologyEx(img_mask, mask, cv::MORPH_OPEN, morphKernel, cv::Point(1, 1));
 
     if(showBlobMask)
-        cvShowImage("Blob Mask", segmentated);
+        cv::imshow("Blob Mask", mask);
+
+    if(!labelImg || labelImg->width != mask.cols || labelImg->height != mask.rows)
+    {
+        if(labelImg)
+            cvReleaseImage(&labelImg);
+        labelImg = cvCreateImage(cvSize(mask.cols, mask.rows), IPL_DEPTH_LABEL, 1);
+    }
 
-    IplImage* labelImg = cvCreateImage(cvGetSize(frame), IPL_DEPTH_LABEL, 1);
+    IplImage segmentated = mask;
 
     cvb::CvBlobs blobs;
-    unsigned int result = cvb::cvLabel(segmentated, labelImg, blobs);
+    unsigned int result = cvb::cvLabel(&segmentated, labelImg, blobs);
 
     //cvb::cvFilterByArea(blobs, 500, 1000000);
     cvb::cvFilterByArea(blobs, minArea, maxArea);
 
-    //cvb::cvRenderBlobs(labelImg, blobs, frame, frame, CV_BLOB_RENDER_BOUNDING_BOX);
-    if(debugBlob)
-        cvb::cvRenderBlobs(labelImg, blobs, frame, frame, CV_BLOB_RENDER_BOUNDING_BOX|CV_BLOB_RENDER_CENTROID|CV_BLOB_RENDER_ANGLE|CV_BLOB_RENDER_TO_STD);
-    else
-        cvb::cvRenderBlobs(labelImg, blobs, frame, frame, CV_BLOB_RENDER_BOUNDING_BOX|CV_BLOB_RENDER_CENTROID|CV_BLOB_RENDER_ANGLE);
-
     cvb::cvUpdateTracks(blobs, tracks, 40., 10);
 
-    if(debugTrack)
-        cvb::cvRenderTracks(tracks, frame, frame, CV_TRACK_RENDER_ID|CV_TRACK_RENDER_BOUNDING_BOX|CV_TRACK_RENDER_TO_STD);
-    else
-        cvb::cvRenderTracks(tracks, frame, frame, CV_TRACK_RENDER_ID|CV_TRACK_RENDER_BOUNDING_BOX);
+    // render only when someone looks at the result
+    if(renderOutput || showOutput)
+    {
+        img_input.copyTo(img_output);
+        IplImage frame = img_output;
+
+        //cvb::cvRenderBlobs(labelImg, blobs, &frame, &frame, CV_BLOB_RENDER_BOUNDING_BOX);
+        if(debugBlob)
+            cvb::cvRenderBlobs(labelImg, blobs, &frame, &frame, CV_BLOB_RENDER_BOUNDING_BOX|CV_BLOB_RENDER_CENTROID|CV_BLOB_RENDER_ANGLE|CV_BLOB_RENDER_TO_STD);
+        else
+            cvb::cvRenderBlobs(labelImg, blobs, &frame, &frame, CV_BLOB_RENDER_BOUNDING_BOX|CV_BLOB_RENDER_CENTROID|CV_BLOB_RENDER_ANGLE);
 
-    //std::map<CvID, CvTrack *> CvTracks
+        if(debugTrack)
+            cvb::cvRenderTracks(tracks, &frame, &frame, CV_TRACK_RENDER_ID|CV_TRACK_RENDER_BOUNDING_BOX|CV_TRACK_RENDER_TO_STD);
+        else
+            cvb::cvRenderTracks(tracks, &frame, &frame, CV_TRACK_RENDER_ID|CV_TRACK_RENDER_BOUNDING_BOX);
 
-    if(showOutput)
-        cvShowImage("Blob Tracking", frame);
+        //std::map<CvID, CvTrack *> CvTracks
 
-    cv::Mat img_result = cv::cvarrToMat(frame);
-    img_result.copyTo(img_output);
+        if(showOutput)
+            cv::imshow("Blob Tracking", img_output);
+    }
 
-    //cvReleaseImage(&frame);
-    //cvReleaseImage(&segmentated);
-    cvReleaseImage(&labelImg);
-    delete frame;
-    delete segmentated;
     cvReleaseBlobs(blobs);
-    cvReleaseStructuringElement(&morphKernel);
 
     firstTime = false;
 }
 
 void BlobTracking::saveConfig()
 {
-    CvFileStorage* fs = cvOpenFileStorage("config/BlobTracking.xml", 0, CV_STORAGE_WRITE);
+    CvFileStorage* fs = cvOpenFileStorage(configFile.c_str(), 0, CV_STORAGE_WRITE);
 
     cvWriteInt(fs, "minArea", minArea);
     cvWriteInt(fs, "maxArea", maxArea);
@@ -93,7 +110,7 @@ void BlobTracking::saveConfig()
 
 void BlobTracking::loadConfig()
 {
-    CvFileStorage* fs = cvOpenFileStorage("config/BlobTracking.xml", 0, CV_STORAGE_READ);
+    CvFileStorage* fs = cvOpenFileStorage(configFile.c_str(), 0, CV_STORAGE_READ);
 
     minArea = cvReadIntByName(fs, 0, "minArea", 500);
     maxArea = cvReadIntByName(fs, 0, "maxArea", 20000);
@@ -101,7 +118,9 @@ void BlobTracking::loadConfig()
     debugTrack = cvReadIntByName(fs, 0, "debugTrack", false);
     debugBlob = cvReadIntByName(fs, 0, "debugBlob", false);
     showBlobMask = cvReadIntByName(fs, 0, "showBlobMask", false);
-    showOutput = cvReadIntByName(fs, 0, "showOutput", true);
+    showOutput = cvReadIntByName(fs, 0, "showOutput", false);
 
     cvReleaseFileStorage(&fs);
+
+    configLoaded = true;
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <string>
 #include <opencv2/opencv.hpp>
 
 #include "cvBlob/cvblob.h"
@@ -9,6 +10,8 @@ class BlobTracking
 {
 private:
     bool firstTime;
+    bool configLoaded;
+    std::string configFile;
     int minArea;
     int maxArea;
 
@@ -16,16 +19,29 @@ private:
     bool debugBlob;
     bool showBlobMask;
     bool showOutput;
+    bool renderOutput;
+
+    cv::Mat morphKernel;
+    cv::Mat mask;
+    IplImage* labelImg;
 
     cvb::CvTracks tracks;
     void saveConfig();
     void loadConfig();
 
 public:
-    BlobTracking();
+    BlobTracking(const std::string &config = "config/BlobTracking.xml");
     ~BlobTracking();
 
     void process(const cv::Mat &img_input, const cv::Mat &img_mask, cv::Mat &img_output);
+
+    // the config is read on the first process(); call this to pick up edits
+    void reloadConfig();
+
+    // img_output is only written when rendering is turned on here or showOutput
+    // is set in the config; both are off by default
+    void setRenderOutput(bool render);
+
     const cvb::CvTracks getTracks();
 };
 
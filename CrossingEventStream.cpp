@@ -0,0 +1,91 @@
+#include "CrossingEventStream.h"
+#include <sys/time.h>
+
+BinaryLogSink::BinaryLogSink(const char* file)
+{
+    _fp = fopen(file, "ab");
+    if (!_fp) {
+        printf("open %s failed\n", file);
+    }
+}
+
+BinaryLogSink::~BinaryLogSink()
+{
+    if (_fp) {
+        fclose(_fp);
+        _fp = NULL;
+    }
+}
+
+void BinaryLogSink::consume(const CrossingEvent* events, size_t count)
+{
+    if (!_fp) {
+        return;
+    }
+
+    fwrite(events, sizeof(CrossingEvent), count, _fp);
+    fflush(_fp);
+}
+
+void CallbackSink::consume(const CrossingEvent* events, size_t count)
+{
+    if (_callback) {
+        _callback(events, count);
+    }
+}
+
+CrossingEventStream::CrossingEventStream(size_t capacity, size_t maxBatch)
+    : _queue(capacity), _batch(maxBatch > 0 ? maxBatch : 1), _dropped(0)
+{
+}
+
+bool CrossingEventStream::publish(const CrossingEvent& event)
+{
+    if (!_queue.try_enqueue(event)) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    return true;
+}
+
+size_t CrossingEventStream::drain()
+{
+    size_t total = 0;
+
+    for (;;) {
+        size_t n = 0;
+        while (n < _batch.size() && _queue.try_dequeue(_batch[n])) {
+            ++n;
+        }
+
+        if (n == 0) {
+            break;
+        }
+
+        for (size_t i = 0; i < _sinks.size(); ++i) {
+            _sinks[i]->consume(&_batch[0], n);
+        }
+
+        total += n;
+        if (n < _batch.size()) {
+            break;
+        }
+    }
+
+    return total;
+}
+
+void CrossingEventStream::addSink(ICrossingSink* sink)
+{
+    if (sink) {
+        _sinks.push_back(sink);
+    }
+}
+
+int64_t CrossingEventStream::now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec*1000000 + tv.tv_usec;
+}
@@ -0,0 +1,96 @@
+#ifndef CROSSINGEVENTSTREAM_H
+#define CROSSINGEVENTSTREAM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+#include "readerwriterqueue.h"
+
+#define CROSSING_IN                    1	//进
+#define CROSSING_OUT                   2	//出
+
+#define CROSSING_ZONE_LINE             -1	//主检测线（init() 设置的线），其他值为 CountingZone::nID
+
+// One counted crossing. Plain data so it can be copied through the queue and
+// written to disk as is.
+typedef struct CrossingEvent
+{
+    int64_t timestamp;      // microseconds since the epoch
+    int trackId;
+    int zone;               // CROSSING_ZONE_LINE or CountingZone::nID
+    int direction;          // CROSSING_IN / CROSSING_OUT
+    float x;                // centroid
+    float y;
+} CrossingEvent;
+
+class ICrossingSink
+{
+public:
+    virtual ~ICrossingSink() {}
+
+    virtual void consume(const CrossingEvent* events, size_t count) = 0;
+};
+
+// Appends raw CrossingEvent records to a file.
+class BinaryLogSink : public ICrossingSink
+{
+public:
+    explicit BinaryLogSink(const char* file = "log/crossings.bin");
+
+    ~BinaryLogSink();
+
+    bool isOpened() const { return _fp != NULL; }
+
+    void consume(const CrossingEvent* events, size_t count);
+
+private:
+    FILE* _fp;
+};
+
+class CallbackSink : public ICrossingSink
+{
+public:
+    typedef std::function<void(const CrossingEvent* events, size_t count)> Callback;
+
+    explicit CallbackSink(const Callback& callback) : _callback(callback) {}
+
+    void consume(const CrossingEvent* events, size_t count);
+
+private:
+    Callback _callback;
+};
+
+// Single producer / single consumer event stream. The tracking thread calls
+// publish(), which never blocks or allocates; when the ring is full the event
+// is dropped and counted. A reader thread calls drain() to hand batches to the
+// sinks.
+class CrossingEventStream
+{
+public:
+    explicit CrossingEventStream(size_t capacity = 1024, size_t maxBatch = 64);
+
+    bool publish(const CrossingEvent& event);
+
+    // Returns the number of events delivered.
+    size_t drain();
+
+    // Sinks must be added before the reader starts draining.
+    void addSink(ICrossingSink* sink);
+
+    size_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+    size_t pending() const { return _queue.size_approx(); }
+
+    static int64_t now();
+
+private:
+    moodycamel::ReaderWriterQueue<CrossingEvent> _queue;
+    std::vector<CrossingEvent> _batch;
+    std::vector<ICrossingSink*> _sinks;
+    std::atomic<size_t> _dropped;
+};
+
+#endif // CROSSINGEVENTSTREAM_H
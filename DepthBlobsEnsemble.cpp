@@ -0,0 +1,237 @@
+#include "DepthBlobsEnsemble.h"
+#include "FramePool.h"
+#include <algorithm>
+
+static bool largerArea(const Detection& a, const Detection& b) {
+    return a.area > b.area;
+}
+
+DepthBlobsEnsemble::DepthBlobsEnsemble(float nmsThreshold)
+{
+    _stagePixels = NULL;
+    _nmsThreshold = nmsThreshold;
+    _stopWorkers = false;
+    pthread_mutex_init(&_workerMutex, NULL);
+    pthread_cond_init(&_jobCond, NULL);
+    pthread_cond_init(&_doneCond, NULL);
+
+    FramePool::instance().adopt(_mask);
+}
+
+DepthBlobsEnsemble::~DepthBlobsEnsemble() {
+    pthread_mutex_lock(&_workerMutex);
+    _stopWorkers = true;
+    pthread_cond_broadcast(&_jobCond);
+    pthread_mutex_unlock(&_workerMutex);
+    for (size_t i = 0; i < _jobs.size(); ++i) {
+        if (_jobs[i]->started) {
+            pthread_join(_jobs[i]->worker, 0);
+        }
+        delete _jobs[i];
+    }
+    _jobs.clear();
+
+    pthread_cond_destroy(&_doneCond);
+    pthread_cond_destroy(&_jobCond);
+    pthread_mutex_destroy(&_workerMutex);
+
+    for (size_t i = 0; i < _configs.size(); ++i) {
+        delete _configs[i];
+    }
+    _configs.clear();
+}
+
+DepthBlobsExtracter& DepthBlobsEnsemble::addConfig(int steps,
+                                                   int minDepth,
+                                                   int maxDepth,
+                                                   int minArea,
+                                                   int maxArea,
+                                                   float minDensity,
+                                                   float maxDensity,
+                                                   int margin) {
+    _configs.push_back(new DepthBlobsExtracter(steps, minDepth, maxDepth, minArea, maxArea, minDensity, maxDensity, margin));
+
+    SliceJob* job = new SliceJob();
+    job->owner = this;
+    job->extracter = _configs.back();
+    job->started = false;
+    job->pending = false;
+    _jobs.push_back(job);
+
+    return *_configs.back();
+}
+
+void DepthBlobsEnsemble::addPreprocessor(IPreprocessor* stage) {
+    _region.addPreprocessor(stage);
+}
+
+void DepthBlobsEnsemble::setBackgroundModel(BackgroundDepthModel* model) {
+    _region.setBackgroundModel(model);
+}
+
+void DepthBlobsEnsemble::setProcessingRoi(const cv::Rect& roi) {
+    _region.setProcessingRoi(roi);
+}
+
+void DepthBlobsEnsemble::setStagePixels(StagePixels* stats) {
+    _stagePixels = stats;
+}
+
+void* DepthBlobsEnsemble::thread_Slice(void* arg) {
+    SliceJob* job = (SliceJob*)arg;
+    DepthBlobsEnsemble* self = job->owner;
+
+    // 常驻线程：等到有任务就执行一次，直到集成器析构
+    pthread_mutex_lock(&self->_workerMutex);
+    for (;;) {
+        while (!job->pending && !self->_stopWorkers) {
+            pthread_cond_wait(&self->_jobCond, &self->_workerMutex);
+        }
+        if (self->_stopWorkers) {
+            break;
+        }
+        pthread_mutex_unlock(&self->_workerMutex);
+
+        job->extracter->sliceBlobs(*job->src, job->roi, job->bounds, cv::Mat(), 0, job->layers, job->blobs);
+
+        pthread_mutex_lock(&self->_workerMutex);
+        job->pending = false;
+        pthread_cond_broadcast(&self->_doneCond);
+    }
+    pthread_mutex_unlock(&self->_workerMutex);
+    return NULL;
+}
+
+void DepthBlobsEnsemble::buildLayers(const cv::Mat& src, const cv::Mat& tiles, int tileSize) {
+    // 所有配置用到的层合在一起，每层只阈值化、标记一次
+    DepthLayers needed;
+    for (size_t i = 0; i < _configs.size(); ++i) {
+        const std::vector<int>& bounds = _configs[i]->planSlices(src);
+        for (size_t j = 0; j < bounds.size(); ++j) {
+            needed.insert(std::make_pair(std::make_pair(_configs[i]->minDepth(), bounds[j]), CBlobResult()));
+        }
+    }
+
+    _layers.swap(needed);
+
+    _mask.create(src.size(), CV_8UC1);
+    for (DepthLayers::iterator it = _layers.begin(); it != _layers.end(); ++it) {
+        int lower = it->first.first;
+        int upper = it->first.second;
+        _configs[0]->threshold(src, _mask, lower, upper);
+        // 置零的块只有在下限大于 0 时才在掩膜中为空
+        if (lower > 0) {
+            it->second = CBlobResult(_mask, cv::Mat(), 2, tiles, tileSize, src);
+        } else {
+            it->second = CBlobResult(_mask, cv::Mat(), 2, cv::Mat(), 0, src);
+        }
+        if (_stagePixels) {
+            _stagePixels->threshold += src.total();
+            _stagePixels->labelling += src.total();
+        }
+    }
+
+    // 各配置的线程只读这些层
+    DepthBlobsExtracter::prepareLayers(_layers);
+}
+
+void DepthBlobsEnsemble::suppress(std::vector<Detection>& detections) const {
+    std::sort(detections.begin(), detections.end(), largerArea);
+
+    std::vector<Detection> kept;
+    for (size_t i = 0; i < detections.size(); ++i) {
+        const cv::Rect& rc = detections[i].bbox;
+        bool overlapped = false;
+        for (size_t j = 0; j < kept.size(); ++j) {
+            double inter = (rc & kept[j].bbox).area();
+            double uni = rc.area() + kept[j].bbox.area() - inter;
+            if (uni > 0 && inter / uni > _nmsThreshold) {
+                overlapped = true;
+                break;
+            }
+        }
+        if (!overlapped) {
+            kept.push_back(detections[i]);
+        }
+    }
+
+    detections.swap(kept);
+}
+
+bool DepthBlobsEnsemble::detects(const cv::Mat& frame, std::vector<Detection>& detections, bool withRuns) {
+    detections.clear();
+    if (_configs.empty()) {
+        return true;
+    }
+
+    // 处理区域（有背景模型时只取有变化的块），没有前景直接返回
+    if (!_region.select(frame)) {
+        return true;
+    }
+
+    const cv::Mat& src = _region.src();
+    cv::Rect roi = _region.roi();
+
+    buildLayers(src, _region.tiles(), _region.tileSize());
+
+    // 各配置并行筛选、跨层匹配，第一个配置在当前线程执行，其余交给常驻线程
+    for (size_t i = 0; i < _jobs.size(); ++i) {
+        SliceJob* job = _jobs[i];
+        job->src = &src;
+        job->roi = roi;
+        job->bounds = _region.bounds();
+        job->layers = &_layers;
+        if (i > 0 && !job->started) {
+            job->started = pthread_create(&job->worker, NULL, DepthBlobsEnsemble::thread_Slice, job) == 0;
+        }
+    }
+
+    pthread_mutex_lock(&_workerMutex);
+    for (size_t i = 1; i < _jobs.size(); ++i) {
+        _jobs[i]->pending = _jobs[i]->started;
+    }
+    pthread_cond_broadcast(&_jobCond);
+    pthread_mutex_unlock(&_workerMutex);
+
+    for (size_t i = 0; i < _jobs.size(); ++i) {
+        SliceJob* job = _jobs[i];
+        if (i == 0 || !job->started) {
+            job->extracter->sliceBlobs(src, roi, job->bounds, cv::Mat(), 0, &_layers, job->blobs);
+        }
+    }
+
+    pthread_mutex_lock(&_workerMutex);
+    for (size_t i = 1; i < _jobs.size(); ++i) {
+        while (_jobs[i]->pending) {
+            pthread_cond_wait(&_doneCond, &_workerMutex);
+        }
+    }
+    pthread_mutex_unlock(&_workerMutex);
+
+    for (size_t i = 0; i < _jobs.size(); ++i) {
+        CBlobResult& blobs = _jobs[i]->blobs;
+        for (int j = 0; j < blobs.GetNumBlobs(); ++j) {
+            detections.push_back(Detection());
+            blobToDetection(blobs.GetBlob(j), roi.tl(), withRuns, detections.back());
+        }
+        blobs.ClearBlobs();
+    }
+
+    suppress(detections);
+
+    return true;
+}
+
+void DepthBlobsEnsemble::extracts(const cv::Mat& frame, cv::Mat& dst) {
+    std::vector<Detection> detections;
+    detects(frame, detections, true);
+
+    dst.setTo(0);
+    for (size_t i = 0; i < detections.size(); ++i) {
+        const std::vector<cv::Vec3i>& runs = detections[i].runs;
+        for (size_t j = 0; j < runs.size(); ++j) {
+            uchar* row = dst.ptr<uchar>(runs[j][0]);
+            std::fill(row + runs[j][1], row + runs[j][2], (uchar)255);
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef DEPTHBLOBSENSEMBLE_H
+#define DEPTHBLOBSENSEMBLE_H
+
+#include "opencv2/core/core.hpp"
+#include "IExtracter.h"
+#include "DepthBlobsExtracter.h"
+#include "BackgroundDepthModel.h"
+#include "DepthFrameRegion.h"
+#include <pthread.h>
+#include <vector>
+
+// Runs several DepthBlobsExtracter configurations on one frame. Every distinct
+// (minDepth, upper) layer any configuration asks for is thresholded and
+// labelled once; the configurations then filter and match those layers in
+// place, concurrently, and their detections are fused with non-maximum
+// suppression on the bounding boxes. The first configuration runs on the
+// caller's thread, each other one on a worker thread started by the first
+// detection and kept until the ensemble is destroyed.
+class DepthBlobsEnsemble : public IExtracter
+{
+public:
+    DepthBlobsEnsemble(float nmsThreshold = 0.3f);
+
+    ~DepthBlobsEnsemble();
+
+    // Same parameters as DepthBlobsExtracter. The ensemble owns the extracter;
+    // the returned reference can be used for setAdaptiveSlicing().
+    DepthBlobsExtracter& addConfig(int steps = 50,
+                                   int minDepth = 400,
+                                   int maxDepth = 2000,
+                                   int minArea = 500,
+                                   int maxArea = 1500,
+                                   float minDensity = 0.45,
+                                   float maxDensity = 0.90,
+                                   int margin = 5);
+
+    // Shared by all configurations, run once per frame before the background
+    // model, see DepthBlobsExtracter::addPreprocessor().
+    void addPreprocessor(IPreprocessor* stage);
+
+    // Shared by all configurations, applied once per frame.
+    void setBackgroundModel(BackgroundDepthModel* model);
+
+    // Shared by all configurations, see DepthBlobsExtracter::setProcessingRoi().
+    void setProcessingRoi(const cv::Rect& roi);
+
+    // Threshold and labelling pixel counts of the shared layers go to stats.
+    void setStagePixels(StagePixels* stats);
+
+    void extracts(const cv::Mat& src, cv::Mat& dst);
+
+    bool detects(const cv::Mat& src, std::vector<Detection>& detections, bool withRuns = false);
+
+private:
+    DepthBlobsEnsemble(const DepthBlobsEnsemble&);
+    DepthBlobsEnsemble& operator=(const DepthBlobsEnsemble&);
+
+    struct SliceJob
+    {
+        DepthBlobsEnsemble* owner;
+        DepthBlobsExtracter* extracter;
+        const cv::Mat* src;
+        cv::Rect roi;
+        cv::Rect bounds;
+        const DepthLayers* layers;
+        CBlobResult blobs;
+
+        pthread_t worker;
+        bool started;
+        bool pending;
+    };
+
+    static void* thread_Slice(void* arg);
+
+    void buildLayers(const cv::Mat& src, const cv::Mat& tiles, int tileSize);
+
+    void suppress(std::vector<Detection>& detections) const;
+
+    std::vector<DepthBlobsExtracter*> _configs;
+    std::vector<SliceJob*> _jobs;
+    pthread_mutex_t _workerMutex;
+    pthread_cond_t _jobCond;
+    pthread_cond_t _doneCond;
+    bool _stopWorkers;
+    DepthFrameRegion _region;
+    StagePixels* _stagePixels;
+    float _nmsThreshold;
+
+    cv::Mat _mask;
+    DepthLayers _layers;
+};
+
+#endif // DEPTHBLOBSENSEMBLE_H
@@ -1,5 +1,8 @@
 #include "DepthBlobsExtracter.h"
+#include "DepthPyramid.h"
+#include "FramePool.h"
 #include "opencv2/imgproc/imgproc.hpp"
+#include <climits>
 
 DepthBlobsExtracter::DepthBlobsExtracter(int step,
                                          int minDepth,
@@ -9,6 +12,7 @@ DepthBlobsExtracter::DepthBlobsExtracter(int step,
                                          float minDensity,
                                          float maxDensity,
                                          int margin)
+    : _planner(minDepth, maxDepth)
 {
      _step = step;
      _minDepth = minDepth;
@@ -18,24 +22,162 @@ DepthBlobsExtracter::DepthBlobsExtracter(int step,
      _minDensity = minDensity;
      _maxDensity = maxDensity;
      _margin = margin;
+     _maxDepthStdDev = 0;
+     _adaptive = false;
+     _stagePixels = NULL;
+     _pyramid = 1;
+     _pyramidPadding = 8;
+     _coarse = NULL;
+
+     // 这些缓冲区的大小随处理区域、窗口变化，从帧缓冲池分配
+     FramePool::instance().adopt(_windowSrc);
+     FramePool::instance().adopt(_mask);
 }
 
-void DepthBlobsExtracter::extracts(const cv::Mat& src, cv::Mat& dst) {
+DepthBlobsExtracter::~DepthBlobsExtracter() {
+    delete _coarse;
+    _coarse = NULL;
+}
+
+void DepthBlobsExtracter::setPyramid(int factor, int padding) {
+    delete _coarse;
+    _coarse = NULL;
+
+    _pyramid = factor;
+    _pyramidPadding = padding;
+    if (factor > 1) {
+        // 粗层面积按比例缩小；边缘不在粗层过滤（-1），由细层处理
+        int area = factor*factor;
+        _coarse = new DepthBlobsExtracter(_step, _minDepth, _maxDepth,
+                                          _minArea / area, _maxArea / area,
+                                          _minDensity, _maxDensity, -1);
+        _coarse->setStagePixels(_stagePixels);
+    }
+}
+
+void DepthBlobsExtracter::addPreprocessor(IPreprocessor* stage) {
+    _region.addPreprocessor(stage);
+}
+
+void DepthBlobsExtracter::setBackgroundModel(BackgroundDepthModel* model) {
+    _region.setBackgroundModel(model);
+}
+
+void DepthBlobsExtracter::setProcessingRoi(const cv::Rect& roi) {
+    _region.setProcessingRoi(roi);
+}
+
+void DepthBlobsExtracter::setStagePixels(StagePixels* stats) {
+    _stagePixels = stats;
+    if (_coarse) {
+        _coarse->setStagePixels(stats);
+    }
+}
+
+void DepthBlobsExtracter::setMaxDepthStdDev(float maxStdDev) {
+    _maxDepthStdDev = maxStdDev;
+}
+
+void DepthBlobsExtracter::setAdaptiveSlicing(bool adaptive) {
+    _adaptive = adaptive;
+}
+
+bool DepthBlobsExtracter::extractBlobs(const cv::Mat& frame) {
+
+    _windows.clear();
+
+    // 处理区域（有背景模型时只取有变化的块），没有前景直接返回
+    if (!_region.select(frame)) {
+        return false;
+    }
+
+    const cv::Mat& src = _region.src();
+    cv::Rect roi = _region.roi();
+
+    // 置零的块在各层掩膜中都为空（深度 0 在 _minDepth 以下），标记时跳过
+    cv::Mat tiles;
+    if (_minDepth > 0) {
+        tiles = _region.tiles();
+    }
+
+    planSlices(src);
 
-    int currentDepthLower = _minDepth;
-    int currentDepthUpper = currentDepthLower + _step;
+    if (!_coarse) {
+        _windows.push_back(roi);
+        _windowBlobs.resize(1);
+        sliceBlobs(src, roi, _region.bounds(), tiles, _region.tileSize(), NULL, _windowBlobs[0]);
+        return true;
+    }
+
+    // 金字塔：先在 1/_pyramid 分辨率上找候选团块，只在候选窗口内按原分辨率细化
+    minPoolDepth(src, _pooled, _pyramid);
+    _coarse->setAdaptiveSlicing(_adaptive);
+    _coarse->planSlices(_pooled);
 
-    cv::Mat mask = cv::Mat::zeros(src.size(), CV_8UC1);
+    CBlobResult coarseBlobs;
+    _coarse->sliceBlobs(_pooled, cv::Rect(0, 0, _pooled.cols, _pooled.rows), cv::Rect(0, 0, _pooled.cols, _pooled.rows), cv::Mat(), 0, NULL, coarseBlobs);
+
+    std::vector<cv::Rect> candidates;
+    for (int i = 0; i < coarseBlobs.GetNumBlobs(); ++i) {
+        candidates.push_back(coarseBlobs.GetBlob(i)->GetBoundingBox());
+    }
+
+    std::vector<cv::Rect> windows;
+    coarseToFineWindows(candidates, _pyramid, _pyramidPadding, src.size(), windows);
+
+    _windowBlobs.resize(windows.size());
+    for (size_t i = 0; i < windows.size(); ++i) {
+        cv::Rect window = windows[i] + roi.tl();
+        _windows.push_back(window);
+        // threshold() 按连续内存处理，窗口先拷出来
+        src(windows[i]).copyTo(_windowSrc);
+        sliceBlobs(_windowSrc, window, _region.bounds(), cv::Mat(), 0, NULL, _windowBlobs[i]);
+    }
+
+    return true;
+}
+
+const std::vector<int>& DepthBlobsExtracter::planSlices(const cv::Mat& src) {
+    // 每层的深度上限，自适应时取深度直方图的持久极值点
+    if (_adaptive) {
+        _planner.plan(src, _step, _bounds);
+    } else {
+        _planner.uniform(_step, _bounds);
+    }
+
+    return _bounds;
+}
+
+void DepthBlobsExtracter::sliceBlobs(const cv::Mat& src,
+                                     const cv::Rect& roi,
+                                     const cv::Rect& bounds,
+                                     const cv::Mat& tiles,
+                                     int tileSize,
+                                     const DepthLayers* layers,
+                                     CBlobResult& historyLayerBlobs) {
+    historyLayerBlobs.ClearBlobs();
+
+    if (layers) {
+        matchSharedLayers(roi, bounds, *layers, historyLayerBlobs);
+        return;
+    }
+
+    // threshold() 写满掩膜的每个像素，不需要清零
+    _mask.create(src.size(), CV_8UC1);
 
-    CBlobResult historyLayerBlobs;
     CBlobResult currentLayerBlobs;
     //cv::Mat element = cv::getStructuringElement(cv::MORPH_CROSS, cv::Size(3, 3));
-    while (currentDepthUpper < _maxDepth) {
-        threshold(src, mask, _minDepth, currentDepthUpper);
+    for (size_t layer = 0; layer < _bounds.size(); ++layer) {
+        int currentDepthUpper = _bounds[layer];
+        threshold(src, _mask, _minDepth, currentDepthUpper);
         //cv::erode(mask, mask, element, cv::Point(-1, -1), 2);
         //cv::threshold(frame, mask, 0, 255, CV_THRESH_BINARY_INV);
-        currentLayerBlobs = CBlobResult(mask, cv::Mat(), 2);
-        cv::imshow("mask", mask);
+        currentLayerBlobs = CBlobResult(_mask, cv::Mat(), 2, tiles, tileSize, src);
+        cv::imshow("mask", _mask);
+        if (_stagePixels) {
+            _stagePixels->threshold += src.total();
+            _stagePixels->labelling += src.total();
+        }
         //cv::waitKey(0);
         //std::cout << "blobs num before filter = " << currentLayerBlobs.GetNumBlobs() << std::endl;
 
@@ -55,6 +197,15 @@ void DepthBlobsExtracter::extracts(const cv::Mat& src, cv::Mat& dst) {
                                  _minDensity,
                                  _maxDensity);
 
+        // 根据团块内深度的标准差过滤掉头肩粘连等起伏过大的团块
+        if (_maxDepthStdDev > 0) {
+            currentLayerBlobs.Filter(currentLayerBlobs,
+                                     FLT_EXCLUDE,
+                                     CBlobGetDepthStdDev(),
+                                     FLT_GREATER,
+                                     _maxDepthStdDev);
+        }
+
 //        int currNum = currentLayerBlobs.GetNumBlobs();
 //        for (int i = 0; i < currNum; ++i) {
 //            CBlob* currBlob = currentLayerBlobs.GetBlob(i);
@@ -164,45 +315,190 @@ void DepthBlobsExtracter::extracts(const cv::Mat& src, cv::Mat& dst) {
                 }
             }
         }
-
-        currentDepthLower += _step;
-        currentDepthUpper = currentDepthLower + _step;
     }
 
-    // 过滤掉历史层中与图像上、下、左、右四个边缘相交的团块
+    // 过滤掉历史层中与有效区域上、下、左、右四个边缘相交的团块。
+    // 有效区域外没有深度，跨过处理区域边缘的头部会被截成半个，密度照样能通过筛选，
+    // 所以处理区域的边缘和图像边缘一样对待
     historyLayerBlobs.Filter(historyLayerBlobs,
                              FLT_EXCLUDE,
                              CBlobGetMaxY(),
                              FLT_GREATEROREQUAL,
-                             mask.rows-_margin);
+                             bounds.y+bounds.height-_margin-roi.y);
 
     historyLayerBlobs.Filter(historyLayerBlobs,
                              FLT_EXCLUDE,
                              CBlobGetMinY(),
                              FLT_LESSOREQUAL,
-                             _margin);
+                             bounds.y+_margin-roi.y);
 
     historyLayerBlobs.Filter(historyLayerBlobs,
                              FLT_EXCLUDE,
                              CBlobGetMinX(),
                              FLT_LESSOREQUAL,
-                             _margin);
+                             bounds.x+_margin-roi.x);
 
     historyLayerBlobs.Filter(historyLayerBlobs,
                              FLT_EXCLUDE,
                              CBlobGetMaxX(),
                              FLT_GREATEROREQUAL,
-                             mask.cols-_margin);
+                             bounds.x+bounds.width-_margin-roi.x);
+}
+
+void DepthBlobsExtracter::prepareLayers(DepthLayers& layers) {
+    for (DepthLayers::iterator it = layers.begin(); it != layers.end(); ++it) {
+        for (int i = 0; i < it->second.GetNumBlobs(); ++i) {
+            CBlob* blob = it->second.GetBlob(i);
+            blob->GetBoundingBox();
+            blob->GetExternalContour()->GetContourPoints();
+        }
+    }
+}
+
+bool DepthBlobsExtracter::acceptBlob(CBlob* blob) const {
+    double area = CBlobGetRectArea()(*blob);
+    if (area < _minArea || area > _maxArea) {
+        return false;
+    }
+
+    double density = CBlobGetMinEnclosingCircleAreaRatio()(*blob);
+    if (density < _minDensity || density > _maxDensity) {
+        return false;
+    }
+
+    return _maxDepthStdDev <= 0 || CBlobGetDepthStdDev()(*blob) <= _maxDepthStdDev;
+}
+
+static bool circlesIntersect(CBlob* a, CBlob* b) {
+    float ra, rb;
+    cv::Point2f ca, cb;
+    cv::minEnclosingCircle(a->GetExternalContour()->GetContourPoints(), ca, ra);
+    cv::minEnclosingCircle(b->GetExternalContour()->GetContourPoints(), cb, rb);
+    float dx = ca.x - cb.x;
+    float dy = ca.y - cb.y;
+    return std::sqrt(dx*dx + dy*dy) <= ra + rb;
+}
+
+void DepthBlobsExtracter::matchSharedLayers(const cv::Rect& roi,
+                                            const cv::Rect& bounds,
+                                            const DepthLayers& layers,
+                                            CBlobResult& blobs) {
+    // 与 sliceBlobs() 中逐层拷贝筛选的流程相同，共享层的团块只读，
+    // 认证、删除标记记在本配置自己的数组里
+    _history.clear();
+    for (size_t layer = 0; layer < _bounds.size(); ++layer) {
+        DepthLayers::const_iterator it = layers.find(std::make_pair(_minDepth, _bounds[layer]));
+        if (it == layers.end()) {
+            continue;
+        }
+
+        CBlobResult& shared = const_cast<CBlobResult&>(it->second);
+        _current.clear();
+        for (int i = 0; i < shared.GetNumBlobs(); ++i) {
+            CBlob* blob = shared.GetBlob(i);
+            if (acceptBlob(blob)) {
+                _current.push_back(blob);
+            }
+        }
+
+        if (_history.empty()) {
+            for (size_t i = 0; i < _current.size(); ++i) {
+                _history.push_back(std::make_pair(_current[i], false));
+            }
+            continue;
+        }
+
+        // 未认证的历史团块被当前层最近的团块包含时，用当前团块替换并完成认证
+        size_t histNum = _history.size();
+        _historyDeleted.assign(histNum, 0);
+        _currentDeleted.assign(_current.size(), 0);
+        for (size_t i = 0; i < histNum; ++i) {
+            if (_history[i].second || _current.empty()) {
+                continue;
+            }
+
+            CBlob* histBlob = _history[i].first;
+            cv::Point centre = histBlob->getCenter();
+            size_t nearest = 0;
+            int minD = INT_MAX;
+            for (size_t j = 0; j < _current.size(); ++j) {
+                cv::Point diff = _current[j]->getCenter() - centre;
+                int d = diff.x*diff.x + diff.y*diff.y;
+                if (d < minD) {
+                    minD = d;
+                    nearest = j;
+                }
+            }
+
+            cv::Rect histRect = histBlob->GetBoundingBox();
+            cv::Rect currRect = _current[nearest]->GetBoundingBox();
+            if ((histRect & currRect) == histRect) {
+                _history.push_back(std::make_pair(_current[nearest], true));
+                _historyDeleted[i] = 1;
+                _currentDeleted[nearest] = 1;
+            }
+        }
 
-    int histNum = historyLayerBlobs.GetNumBlobs();
+        size_t kept = 0;
+        for (size_t i = 0; i < _history.size(); ++i) {
+            if (i >= histNum || !_historyDeleted[i]) {
+                _history[kept++] = _history[i];
+            }
+        }
+        _history.resize(kept);
 
+        // 与历史层团块都不相交的当前团块加入历史层
+        size_t num = _history.size();
+        for (size_t i = 0; i < _current.size(); ++i) {
+            if (_currentDeleted[i]) {
+                continue;
+            }
+            bool intersect = false;
+            for (size_t j = 0; j < num; ++j) {
+                if (circlesIntersect(_current[i], _history[j].first)) {
+                    intersect = true;
+                    break;
+                }
+            }
+            if (!intersect) {
+                _history.push_back(std::make_pair(_current[i], false));
+            }
+        }
+    }
+
+    // 与有效区域边缘相交的团块丢掉，见 sliceBlobs()；留下的团块才拷贝出去
+    int minY = bounds.y + _margin - roi.y;
+    int maxY = bounds.y + bounds.height - _margin - roi.y;
+    int minX = bounds.x + _margin - roi.x;
+    int maxX = bounds.x + bounds.width - _margin - roi.x;
+    for (size_t i = 0; i < _history.size(); ++i) {
+        CBlob* blob = _history[i].first;
+        if (blob->MaxY() >= maxY || blob->MinY() <= minY ||
+            blob->MinX() <= minX || blob->MaxX() >= maxX) {
+            continue;
+        }
+        blobs.AddBlob(blob);
+        blobs.GetBlob(blobs.GetNumBlobs() - 1)->setCompleted(_history[i].second);
+    }
+}
+
+void DepthBlobsExtracter::extracts(const cv::Mat& frame, cv::Mat& dst) {
     dst.setTo(0);
-    for (int i = 0; i < histNum; ++i) {
-        CBlob* histBlob = historyLayerBlobs.GetBlob(i);
-        std::vector<std::vector<cv::Point>> contours;
-        std::vector<cv::Point> points = histBlob->GetExternalContour()->GetContourPoints();
-        contours.push_back(points);
-        cv::drawContours(dst, contours, -1, cv::Scalar(255), -1);
+    if (!extractBlobs(frame)) {
+        return;
+    }
+
+    for (size_t w = 0; w < _windows.size(); ++w) {
+        CBlobResult& historyLayerBlobs = _windowBlobs[w];
+        int histNum = historyLayerBlobs.GetNumBlobs();
+
+        for (int i = 0; i < histNum; ++i) {
+            CBlob* histBlob = historyLayerBlobs.GetBlob(i);
+            std::vector<std::vector<cv::Point>> contours;
+            std::vector<cv::Point> points = histBlob->GetExternalContour()->GetContourPoints();
+            contours.push_back(points);
+            cv::drawContours(dst, contours, -1, cv::Scalar(255), -1, 8, cv::noArray(), INT_MAX, _windows[w].tl());
+        }
     }
 
     //for (size_t i = 0; i < histNum; ++i) {
@@ -226,6 +522,24 @@ void DepthBlobsExtracter::extracts(const cv::Mat& src, cv::Mat& dst) {
     //}
 }
 
+bool DepthBlobsExtracter::detects(const cv::Mat& frame, std::vector<Detection>& detections, bool withRuns) {
+    detections.clear();
+    if (!extractBlobs(frame)) {
+        return true;
+    }
+
+    for (size_t w = 0; w < _windows.size(); ++w) {
+        CBlobResult& historyLayerBlobs = _windowBlobs[w];
+        int histNum = historyLayerBlobs.GetNumBlobs();
+        for (int i = 0; i < histNum; ++i) {
+            detections.push_back(Detection());
+            blobToDetection(historyLayerBlobs.GetBlob(i), _windows[w].tl(), withRuns, detections.back());
+        }
+    }
+
+    return true;
+}
+
 //void DepthBlobsExtracter::extracts(const cv::Mat& src, cv::Mat& dst) {
 
 //    int currentDepthLower = _minDepth;
@@ -4,6 +4,15 @@
 #include "opencv2/core/core.hpp"
 #include "BlobResult.h"
 #include "IExtracter.h"
+#include "DepthSlicePlanner.h"
+#include "BackgroundDepthModel.h"
+#include "DepthFrameRegion.h"
+#include "StagePixels.h"
+#include <map>
+#include <vector>
+
+// Labelled layer masks keyed by (lower depth, upper depth), see DepthBlobsEnsemble.
+typedef std::map<std::pair<int, int>, CBlobResult> DepthLayers;
 
 class DepthBlobsExtracter : public IExtracter
 {
@@ -17,11 +26,91 @@ public:
                         float maxDensity = 0.90,
                         int margin = 5);
 
+    ~DepthBlobsExtracter();
+
     void extracts(const cv::Mat& src, cv::Mat& dst);
 
+    bool detects(const cv::Mat& src, std::vector<Detection>& detections, bool withRuns = false);
+
+    // Slice at the persistent extrema of each frame's depth histogram instead of
+    // every step, falling back to uniform steps when the histogram is flat.
+    void setAdaptiveSlicing(bool adaptive);
+
+    // Depth stages run on every frame before anything else, in the order
+    // added, e.g. HeightTransformer to slice by height above the floor.
+    // Not owned; none by default.
+    void addPreprocessor(IPreprocessor* stage);
+
+    // Only slice the tiles the background model reports as changed; frames
+    // without foreground produce no blobs. NULL (the default) slices everything.
+    void setBackgroundModel(BackgroundDepthModel* model);
+
+    // Drops layer blobs whose depth standard deviation is above maxStdDev (a
+    // head is a shallow dome, a head merged with shoulders spans much more).
+    // The statistics are gathered while labelling. 0 (the default) turns it off.
+    void setMaxDepthStdDev(float maxStdDev);
+
+    // Only threshold and label inside roi (frame coordinates), usually
+    // BlobCounter::processingRoi(). An empty rect (the default) means the
+    // whole frame. Blobs touching the roi's edges are dropped like those on
+    // the frame border, so the approach margin around the counting zones
+    // must be at least one head wide.
+    void setProcessingRoi(const cv::Rect& roi);
+
+    // Threshold and labelling pixel counts go to stats, NULL to stop.
+    void setStagePixels(StagePixels* stats);
+
+    // Coarse-to-fine mode: blobs are first looked for on a 1/factor depth image
+    // (min-pooled, ignoring unknown pixels) and only the candidate windows,
+    // grown by padding, are sliced at full resolution. factor <= 1 turns it off.
+    // Call after the other setters; the coarse pass copies the parameters.
+    void setPyramid(int factor = 4, int padding = 8);
+
     void threshold(const cv::Mat& src, cv::Mat& dst, short min, short max);
 
+    int minDepth() const { return _minDepth; }
+
+    // Plans this configuration's slice bounds for src and returns them.
+    const std::vector<int>& planSlices(const cv::Mat& src);
+
+    // Runs the layer matching over the slices of the last planSlices() call.
+    // With layers the labelled layers are read from there (missing ones are
+    // skipped) instead of thresholding and labelling src: the shared blobs are
+    // filtered and matched by pointer, only the surviving ones are copied into
+    // blobs. The call is then safe to run concurrently with other configurations
+    // on the same layers, provided prepareLayers() was called on them.
+    // Blob coordinates are relative to roi. bounds is the part of the frame
+    // holding depth (the processing roi, or the whole frame): blobs within
+    // margin of its edges are cut off and dropped.
+    void sliceBlobs(const cv::Mat& src,
+                    const cv::Rect& roi,
+                    const cv::Rect& bounds,
+                    const cv::Mat& tiles,
+                    int tileSize,
+                    const DepthLayers* layers,
+                    CBlobResult& blobs);
+
+    // Computes the lazily cached blob properties (bounding box, contour points)
+    // the layer matching reads, so the layers can be shared between threads.
+    static void prepareLayers(DepthLayers& layers);
+
 private:
+    DepthBlobsExtracter(const DepthBlobsExtracter&);
+    DepthBlobsExtracter& operator=(const DepthBlobsExtracter&);
+
+    // 分层提取团块，结果按窗口存入 _windowBlobs，坐标相对 _windows 中对应窗口的左上角；
+    // 没有前景时返回 false
+    bool extractBlobs(const cv::Mat& frame);
+
+    // 面积、密度、深度标准差筛选
+    bool acceptBlob(CBlob* blob) const;
+
+    // 共享层的跨层匹配：只记录指针和标记，不拷贝团块
+    void matchSharedLayers(const cv::Rect& roi,
+                           const cv::Rect& bounds,
+                           const DepthLayers& layers,
+                           CBlobResult& blobs);
+
     int _step;
     int _minDepth;
     int _maxDepth;
@@ -30,6 +119,28 @@ private:
     float _minDensity;
     float _maxDensity;
     int _margin;
+    float _maxDepthStdDev;
+
+    bool _adaptive;
+    DepthFrameRegion _region;
+    StagePixels* _stagePixels;
+    DepthSlicePlanner _planner;
+    std::vector<int> _bounds;
+
+    int _pyramid;
+    int _pyramidPadding;
+    DepthBlobsExtracter* _coarse;
+    cv::Mat _pooled;
+    cv::Mat _windowSrc;
+    cv::Mat _mask;
+    std::vector<cv::Rect> _windows;
+    std::vector<CBlobResult> _windowBlobs;
+
+    // 共享层匹配用：当前层、历史层（团块, 已认证）及删除标记
+    std::vector<CBlob*> _current;
+    std::vector<std::pair<CBlob*, bool> > _history;
+    std::vector<char> _currentDeleted;
+    std::vector<char> _historyDeleted;
 };
 
 #endif // DEPTHBLOBSEXTRACTER_H
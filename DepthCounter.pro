@@ -45,10 +45,26 @@ SOURCES += main.cpp \
     mser3.cpp \
     BlobCouting.cpp \
     BlobTracking.cpp \
+    TrajectoryStore.cpp \
     BlobCounter.cpp \
+    CrossingEventStream.cpp \
     BlobTracker.cpp \
+    TrackGapFiller.cpp \
+    FrameScheduler.cpp \
+    FramePool.cpp \
+    Detection.cpp \
+    DetectionCache.cpp \
+    ParameterSweep.cpp \
     DepthBlobsExtracter.cpp \
-    AdaptableBlobsExtracter.cpp
+    DepthBlobsEnsemble.cpp \
+    DepthSlicePlanner.cpp \
+    DepthFrameRegion.cpp \
+    DepthPyramid.cpp \
+    HeightTransformer.cpp \
+    TemporalDepthFilter.cpp \
+    BackgroundDepthModel.cpp \
+    AdaptableBlobsExtracter.cpp \
+    HeadMinimaExtracter.cpp
 
 #LIBS += -L$$PWD/camport_linux2/lib_x64/ -lcamm
 LIBS += -lopencv_core -lopencv_highgui -lopencv_imgproc -lopencv_features2d -lopencv_contrib -lopencv_photo -lopencv_legacy
@@ -67,11 +83,29 @@ HEADERS += \
     mser3.hpp \
     BlobCouting.h \
     BlobTracking.h \
+    TrajectoryStore.h \
     BlobCounter.h \
+    CrossingEventStream.h \
     BlobTracker.h \
+    TrackGapFiller.h \
+    FrameScheduler.h \
+    FramePool.h \
+    Detection.h \
+    DetectionCache.h \
+    ParameterSweep.h \
     DepthBlobsExtracter.h \
+    DepthBlobsEnsemble.h \
+    DepthSlicePlanner.h \
+    DepthFrameRegion.h \
+    DepthPyramid.h \
     AdaptableBlobsExtracter.h \
+    HeadMinimaExtracter.h \
     IExtracter.h \
+    IPreprocessor.h \
+    HeightTransformer.h \
+    TemporalDepthFilter.h \
+    BackgroundDepthModel.h \
+    StagePixels.h \
     persistence1d.hpp
 
 CONFIG(debug, debug|release) {
@@ -0,0 +1,73 @@
+#include "DepthFrameRegion.h"
+#include "FramePool.h"
+
+DepthFrameRegion::DepthFrameRegion()
+{
+    _background = NULL;
+
+    // 处理区域随背景模型变化，缓冲区从帧缓冲池分配
+    FramePool::instance().adopt(_preprocessed);
+    FramePool::instance().adopt(_active);
+}
+
+void DepthFrameRegion::addPreprocessor(IPreprocessor* stage) {
+    if (stage) {
+        _preprocessors.push_back(stage);
+    }
+}
+
+void DepthFrameRegion::setBackgroundModel(BackgroundDepthModel* model) {
+    _background = model;
+}
+
+void DepthFrameRegion::setProcessingRoi(const cv::Rect& roi) {
+    _processingRoi = roi;
+}
+
+bool DepthFrameRegion::select(const cv::Mat& input) {
+    _src = cv::Mat();
+    _tiles = cv::Mat();
+
+    // 只处理设定的处理区域，先裁剪再预处理
+    cv::Rect full(0, 0, input.cols, input.rows);
+    _bounds = _processingRoi.area() > 0 ? _processingRoi & full : full;
+    _roi = _bounds;
+    if (_roi.area() == 0) {
+        return false;
+    }
+
+    // 预处理（时域滤波等需要逐帧连续的状态，处理区域不变时尺寸不变），
+    // 第一级输出到 _preprocessed，之后原地处理
+    cv::Mat frame = input(_bounds);
+    for (size_t i = 0; i < _preprocessors.size(); ++i) {
+        _preprocessors[i]->preprocess(frame, _preprocessed, _bounds.tl());
+        frame = _preprocessed;
+    }
+
+    // 有背景模型时只处理有变化的块，没有前景直接返回；块按处理区域内的坐标
+    cv::Rect local(0, 0, frame.cols, frame.rows);
+    if (_background) {
+        _background->apply(frame);
+        if (!_background->hasForeground()) {
+            return false;
+        }
+
+        local = _background->activeRect();
+        if (local.area() == 0) {
+            return false;
+        }
+        frame(local).copyTo(_active);
+        _background->maskInactive(_active, local.tl());
+        _src = _active;
+        _tiles = _background->grownTiles(local);
+    } else if (!frame.isContinuous()) {
+        // 阈值化按连续内存处理，区域先拷出来
+        frame.copyTo(_active);
+        _src = _active;
+    } else {
+        _src = frame;
+    }
+
+    _roi = local + _bounds.tl();
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef DEPTHFRAMEREGION_H
+#define DEPTHFRAMEREGION_H
+
+#include "opencv2/core/core.hpp"
+#include "BackgroundDepthModel.h"
+#include "IPreprocessor.h"
+#include <vector>
+
+// The part of a depth frame the slicing extracters work on: the processing roi
+// run through the preprocessors, then cut down to the tiles a background model
+// reports as changed, with the pixels outside those tiles zeroed. Shared by
+// DepthBlobsExtracter and DepthBlobsEnsemble.
+class DepthFrameRegion
+{
+public:
+    DepthFrameRegion();
+
+    // Run on the processing roi of every frame in the order added, before the
+    // background model, e.g. HeightTransformer. The stages are not owned.
+    void addPreprocessor(IPreprocessor* stage);
+
+    // Applied to the processing roi of every frame, so its tiles are relative
+    // to bounds(). NULL (the default) keeps the whole roi.
+    void setBackgroundModel(BackgroundDepthModel* model);
+
+    // Frame coordinates, usually BlobCounter::processingRoi(). An empty rect
+    // (the default) means the whole frame.
+    void setProcessingRoi(const cv::Rect& roi);
+
+    // Picks the region of frame. Returns false when there is nothing to slice:
+    // an empty roi, or no foreground. Otherwise src() is the region as a
+    // continuous CV_16UC1 image, roi() where it lies in the frame, and tiles()
+    // the grown active tiles covering it (empty without a background model).
+    bool select(const cv::Mat& frame);
+
+    const cv::Mat& src() const { return _src; }
+
+    const cv::Rect& roi() const { return _roi; }
+
+    // The processing roi clipped to the frame, i.e. where the frame holds depth.
+    const cv::Rect& bounds() const { return _bounds; }
+
+    const cv::Mat& tiles() const { return _tiles; }
+
+    int tileSize() const { return _background ? _background->tileSize() : 0; }
+
+private:
+    std::vector<IPreprocessor*> _preprocessors;
+    BackgroundDepthModel* _background;
+    cv::Rect _processingRoi;
+
+    cv::Mat _preprocessed;
+    cv::Mat _active;
+    cv::Mat _src;
+    cv::Rect _roi;
+    cv::Rect _bounds;
+    cv::Mat _tiles;
+};
+
+#endif // DEPTHFRAMEREGION_H
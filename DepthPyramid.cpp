@@ -0,0 +1,70 @@
+#include "DepthPyramid.h"
+#include <algorithm>
+
+void minPoolDepth(const cv::Mat& src, cv::Mat& dst, int factor) {
+    CV_Assert(src.type() == CV_16UC1 && factor > 0);
+
+    int cols = (src.cols + factor - 1) / factor;
+    int rows = (src.rows + factor - 1) / factor;
+
+    // 0 is unknown: shifting by -1 turns it into 65535 so it loses every min,
+    // shifting back turns all-unknown blocks into 0 again
+    dst.create(rows, cols, CV_16UC1);
+    dst.setTo(cv::Scalar(65535));
+    for (int y = 0; y < src.rows; ++y) {
+        const ushort* sptr = src.ptr<ushort>(y);
+        ushort* dptr = dst.ptr<ushort>(y / factor);
+        for (int x = 0; x < src.cols; ++x) {
+            ushort d = (ushort)(sptr[x] - 1);
+            ushort& m = dptr[x / factor];
+            if (d < m) {
+                m = d;
+            }
+        }
+    }
+
+    for (int y = 0; y < rows; ++y) {
+        ushort* dptr = dst.ptr<ushort>(y);
+        for (int x = 0; x < cols; ++x) {
+            dptr[x] = (ushort)(dptr[x] + 1);
+        }
+    }
+}
+
+void mergeRects(std::vector<cv::Rect>& rects) {
+    for (bool merged = true; merged; ) {
+        merged = false;
+        for (size_t i = 0; i < rects.size() && !merged; ++i) {
+            for (size_t j = i + 1; j < rects.size(); ++j) {
+                if ((rects[i] & rects[j]).area() > 0) {
+                    rects[i] |= rects[j];
+                    rects.erase(rects.begin() + j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void coarseToFineWindows(const std::vector<cv::Rect>& coarse,
+                         int factor,
+                         int padding,
+                         const cv::Size& size,
+                         std::vector<cv::Rect>& windows) {
+    cv::Rect frame(0, 0, size.width, size.height);
+
+    windows.clear();
+    for (size_t i = 0; i < coarse.size(); ++i) {
+        cv::Rect rc(coarse[i].x*factor - padding,
+                    coarse[i].y*factor - padding,
+                    coarse[i].width*factor + 2*padding,
+                    coarse[i].height*factor + 2*padding);
+        rc &= frame;
+        if (rc.area() > 0) {
+            windows.push_back(rc);
+        }
+    }
+
+    mergeRects(windows);
+}
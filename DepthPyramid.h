@@ -0,0 +1,24 @@
+#ifndef DEPTHPYRAMID_H
+#define DEPTHPYRAMID_H
+
+#include "opencv2/core/core.hpp"
+#include <vector>
+
+// Helpers for the coarse-to-fine extraction modes.
+
+// Shrinks a CV_16UC1 depth image by factor, each output pixel the smallest
+// known (non-zero) depth of its block, so holes do not eat heads. Blocks
+// without any known depth stay 0.
+void minPoolDepth(const cv::Mat& src, cv::Mat& dst, int factor);
+
+// Merges overlapping rectangles in place until none overlap.
+void mergeRects(std::vector<cv::Rect>& rects);
+
+// Coarse boxes scaled back by factor, grown by padding, clipped to size and merged.
+void coarseToFineWindows(const std::vector<cv::Rect>& coarse,
+                         int factor,
+                         int padding,
+                         const cv::Size& size,
+                         std::vector<cv::Rect>& windows);
+
+#endif // DEPTHPYRAMID_H
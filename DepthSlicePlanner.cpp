@@ -0,0 +1,110 @@
+#include "DepthSlicePlanner.h"
+#include <algorithm>
+#include <cassert>
+
+DepthSlicePlanner::DepthSlicePlanner(int minDepth,
+                                     int maxDepth,
+                                     int binWidth,
+                                     float minPersistence,
+                                     int maxSlices)
+{
+    _minDepth = minDepth;
+    _maxDepth = maxDepth;
+    _binWidth = std::max(binWidth, 1);
+    _minPersistence = minPersistence;
+    _maxSlices = maxSlices;
+}
+
+void DepthSlicePlanner::uniform(int step, std::vector<int>& bounds) const {
+    bounds.clear();
+    if (step <= 0) {
+        return;
+    }
+    for (int upper = _minDepth + step; upper < _maxDepth; upper += step) {
+        bounds.push_back(upper);
+    }
+}
+
+bool DepthSlicePlanner::plan(const cv::Mat& src, int step, std::vector<int>& bounds) {
+
+    assert(src.type() == CV_16UC1);
+
+    int bins = (_maxDepth - _minDepth + _binWidth - 1) / _binWidth;
+    if (bins < 3) {
+        uniform(step, bounds);
+        return false;
+    }
+
+    _hist.assign(bins, 0);
+    for (int i = 0; i < src.rows; ++i) {
+        const ushort* sptr = src.ptr<ushort>(i);
+        for (int j = 0; j < src.cols; ++j) {
+            int d = sptr[j];
+            if (d > _minDepth && d < _maxDepth) {
+                ++_hist[(d - _minDepth) / _binWidth];
+            }
+        }
+    }
+
+    // a 3-tap box filter keeps sensor noise from showing up as extrema
+    _smoothed.resize(bins);
+    int peak = 0;
+    for (int i = 0; i < bins; ++i) {
+        int l = _hist[std::max(i - 1, 0)];
+        int r = _hist[std::min(i + 1, bins - 1)];
+        _smoothed[i] = (l + _hist[i] + r) / 3.0f;
+        peak = std::max(peak, _hist[i]);
+    }
+
+    if (peak == 0 || !_persistence.runPersistence(_smoothed) ||
+            !_persistence.getPairedExtrema(_pairs, _minPersistence * peak)) {
+        uniform(step, bounds);
+        return false;
+    }
+
+    // pairs come from least to most persistent, keep the most persistent ones
+    // as long as the distinct bounds they give stay within _maxSlices
+    std::vector<int> indices;
+    int globalMin = _persistence.getGlobalMinimumIndex();
+    if (globalMin >= 0) {
+        indices.push_back(globalMin);
+    }
+    for (int i = (int)_pairs.size() - 1; i >= 0; --i) {
+        bool newMin = std::find(indices.begin(), indices.end(), _pairs[i].minIndex) == indices.end();
+        bool newMax = std::find(indices.begin(), indices.end(), _pairs[i].maxIndex) == indices.end();
+        if ((int)indices.size() + newMin + newMax > _maxSlices) {
+            break;
+        }
+        if (newMin) {
+            indices.push_back(_pairs[i].minIndex);
+        }
+        if (newMax) {
+            indices.push_back(_pairs[i].maxIndex);
+        }
+    }
+
+    std::sort(indices.begin(), indices.end());
+
+    // a slice ends at the far edge of its boundary bin, slices adding no
+    // pixels to the previous one would only repeat its blobs
+    bounds.clear();
+    int next = 0;
+    int count = 0, lastCount = 0;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        for (; next <= indices[i]; ++next) {
+            count += _hist[next];
+        }
+        int upper = _minDepth + (indices[i] + 1) * _binWidth;
+        if (upper < _maxDepth && count > lastCount) {
+            bounds.push_back(upper);
+            lastCount = count;
+        }
+    }
+
+    if (bounds.empty()) {
+        uniform(step, bounds);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef DEPTHSLICEPLANNER_H
+#define DEPTHSLICEPLANNER_H
+
+#include "opencv2/core/core.hpp"
+#include "persistence1d.hpp"
+#include <vector>
+
+// Chooses the depth slices DepthBlobsExtracter labels from the frame's depth
+// histogram: slice boundaries are put at the persistent minima (gaps between
+// head/shoulder plateaus) and maxima (the plateaus) found by Persistence1D.
+class DepthSlicePlanner
+{
+public:
+    DepthSlicePlanner(int minDepth = 400,
+                      int maxDepth = 2000,
+                      int binWidth = 10,
+                      float minPersistence = 0.05,
+                      int maxSlices = 16);
+
+    // Fills bounds with the ascending upper depths of the slices in (minDepth, maxDepth),
+    // at most maxSlices of them.
+    // Returns false and falls back to uniform steps of step when the histogram has
+    // no feature persistent enough.
+    bool plan(const cv::Mat& src, int step, std::vector<int>& bounds);
+
+    void uniform(int step, std::vector<int>& bounds) const;
+
+private:
+    int _minDepth;
+    int _maxDepth;
+    int _binWidth;
+    // relative to the highest histogram bin
+    float _minPersistence;
+    int _maxSlices;
+
+    std::vector<int> _hist;
+    std::vector<float> _smoothed;
+    std::vector<p1d::TPairedExtrema> _pairs;
+    p1d::Persistence1D _persistence;
+};
+
+#endif // DEPTHSLICEPLANNER_H
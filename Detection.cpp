@@ -0,0 +1,51 @@
+#include "Detection.h"
+#include "blob.h"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <algorithm>
+#include <climits>
+
+void blobToDetection(CBlob* blob, const cv::Point& offset, bool withRuns, Detection& det) {
+    cv::Rect bbox = blob->GetBoundingBox();
+    double m00 = blob->Moment(0, 0);
+
+    det.bbox = bbox + offset;
+    det.area = blob->Area();
+    if (m00 != 0) {
+        det.centroid.x = blob->Moment(1, 0) / m00 + offset.x;
+        det.centroid.y = blob->Moment(0, 1) / m00 + offset.y;
+    } else {
+        det.centroid.x = bbox.x + bbox.width / 2.0 + offset.x;
+        det.centroid.y = bbox.y + bbox.height / 2.0 + offset.y;
+    }
+
+    det.runs.clear();
+    if (!withRuns || bbox.area() <= 0) {
+        return;
+    }
+
+    // 只在团块外接矩形大小的掩膜里填充外轮廓，再按行压缩。
+    // 掩膜取自每个线程一块只增不减的缓冲区，不再每个团块分配一次
+    static thread_local cv::Mat scratch;
+    if (scratch.rows < bbox.height || scratch.cols < bbox.width) {
+        scratch.create(std::max(scratch.rows, bbox.height), std::max(scratch.cols, bbox.width), CV_8UC1);
+    }
+    cv::Mat mask = scratch(cv::Rect(0, 0, bbox.width, bbox.height));
+    mask.setTo(0);
+    std::vector<std::vector<cv::Point>> contours(1, blob->GetExternalContour()->GetContourPoints());
+    cv::drawContours(mask, contours, -1, cv::Scalar(255), -1, 8, cv::noArray(), INT_MAX, -bbox.tl());
+
+    for (int y = 0; y < mask.rows; ++y) {
+        const uchar* row = mask.ptr<uchar>(y);
+        for (int x = 0; x < mask.cols; ) {
+            if (!row[x]) {
+                ++x;
+                continue;
+            }
+            int begin = x;
+            while (x < mask.cols && row[x]) {
+                ++x;
+            }
+            det.runs.push_back(cv::Vec3i(det.bbox.y + y, det.bbox.x + begin, det.bbox.x + x));
+        }
+    }
+}
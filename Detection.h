@@ -0,0 +1,24 @@
+#ifndef DETECTION_H
+#define DETECTION_H
+
+#include "opencv2/core/core.hpp"
+#include <vector>
+
+class CBlob;
+
+// One extracted blob in frame coordinates, what BlobTracker needs to match
+// it against the tracks without relabelling a mask.
+struct Detection
+{
+    cv::Rect bbox;
+    cv::Point2d centroid;
+    double area;
+
+    // Optional RLE mask: one (y, x begin, x end) run per row segment, x end exclusive.
+    std::vector<cv::Vec3i> runs;
+};
+
+// Fills det from a CBlob whose coordinates are relative to offset.
+void blobToDetection(CBlob* blob, const cv::Point& offset, bool withRuns, Detection& det);
+
+#endif // DETECTION_H
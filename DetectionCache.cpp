@@ -0,0 +1,132 @@
+#include "DetectionCache.h"
+#include <stdint.h>
+#include <string.h>
+
+static const char CACHE_MAGIC[4] = { 'D', 'C', 'C', '1' };
+
+typedef struct CachedDetection
+{
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+    float cx;
+    float cy;
+    float area;
+} CachedDetection;
+
+DetectionCacheWriter::DetectionCacheWriter()
+{
+    _fp = NULL;
+}
+
+DetectionCacheWriter::~DetectionCacheWriter() {
+    close();
+}
+
+bool DetectionCacheWriter::open(const char* file, const cv::Size& frameSize) {
+    close();
+
+    _fp = fopen(file, "wb");
+    if (!_fp) {
+        printf("open %s failed\n", file);
+        return false;
+    }
+
+    int32_t size[2] = { frameSize.width, frameSize.height };
+    fwrite(CACHE_MAGIC, sizeof(CACHE_MAGIC), 1, _fp);
+    fwrite(size, sizeof(size), 1, _fp);
+
+    return true;
+}
+
+void DetectionCacheWriter::writeFrame(const std::vector<Detection>& detections) {
+    if (!_fp) {
+        return;
+    }
+
+    uint32_t n = detections.size();
+    fwrite(&n, sizeof(n), 1, _fp);
+
+    for (size_t i = 0; i < detections.size(); ++i) {
+        const Detection& det = detections[i];
+        CachedDetection rec;
+        rec.x = det.bbox.x;
+        rec.y = det.bbox.y;
+        rec.width = det.bbox.width;
+        rec.height = det.bbox.height;
+        rec.cx = (float)det.centroid.x;
+        rec.cy = (float)det.centroid.y;
+        rec.area = (float)det.area;
+        fwrite(&rec, sizeof(rec), 1, _fp);
+    }
+}
+
+void DetectionCacheWriter::close() {
+    if (_fp) {
+        fclose(_fp);
+        _fp = NULL;
+    }
+}
+
+bool DetectionCache::load(const char* file) {
+    _detections.clear();
+    _offsets.clear();
+
+    FILE* fp = fopen(file, "rb");
+    if (!fp) {
+        printf("open %s failed\n", file);
+        return false;
+    }
+
+    // 整个文件一次读入内存再解析
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    std::vector<char> buffer(length > 0 ? length : 0);
+    bool ok = length >= (long)(sizeof(CACHE_MAGIC) + 2*sizeof(int32_t)) &&
+              fread(&buffer[0], 1, length, fp) == (size_t)length;
+    fclose(fp);
+
+    if (!ok || memcmp(&buffer[0], CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) {
+        printf("%s is not a detection cache\n", file);
+        return false;
+    }
+
+    const char* ptr = &buffer[0] + sizeof(CACHE_MAGIC);
+    const char* end = &buffer[0] + length;
+
+    int32_t size[2];
+    memcpy(size, ptr, sizeof(size));
+    ptr += sizeof(size);
+    _frameSize = cv::Size(size[0], size[1]);
+
+    _offsets.push_back(0);
+    while (ptr + sizeof(uint32_t) <= end) {
+        uint32_t n;
+        memcpy(&n, ptr, sizeof(n));
+        ptr += sizeof(n);
+
+        // 文件尾部不完整的帧丢弃
+        if ((size_t)(end - ptr) < n*sizeof(CachedDetection)) {
+            break;
+        }
+
+        for (uint32_t i = 0; i < n; ++i) {
+            CachedDetection rec;
+            memcpy(&rec, ptr, sizeof(rec));
+            ptr += sizeof(rec);
+
+            Detection det;
+            det.bbox = cv::Rect(rec.x, rec.y, rec.width, rec.height);
+            det.centroid = cv::Point2d(rec.cx, rec.cy);
+            det.area = rec.area;
+            _detections.push_back(det);
+        }
+
+        _offsets.push_back(_detections.size());
+    }
+
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef DETECTIONCACHE_H
+#define DETECTIONCACHE_H
+
+#include "opencv2/core/core.hpp"
+#include "Detection.h"
+#include <stdio.h>
+#include <vector>
+
+// Per-frame extracter output on disk, so tracker and counter settings can be
+// tuned by replaying it instead of rerunning the extracter:
+//
+//     DetectionCacheWriter writer;
+//     writer.open("debug/detections.bin", frame.size());
+//     while (...) { extracter.detects(frame, detections); writer.writeFrame(detections); }
+//
+// File layout, native endianness: "DCC1", int32 width, int32 height, then per
+// frame a uint32 count followed by count records of int32 x, y, w, h and
+// float cx, cy, area. RLE runs are not stored.
+class DetectionCacheWriter
+{
+public:
+    DetectionCacheWriter();
+
+    ~DetectionCacheWriter();
+
+    bool open(const char* file, const cv::Size& frameSize);
+
+    bool isOpened() const { return _fp != NULL; }
+
+    void writeFrame(const std::vector<Detection>& detections);
+
+    void close();
+
+private:
+    FILE* _fp;
+};
+
+// A whole cache file in memory: all detections in one array, frames are
+// ranges of it.
+class DetectionCache
+{
+public:
+    bool load(const char* file);
+
+    size_t frames() const { return _offsets.empty() ? 0 : _offsets.size() - 1; }
+
+    const cv::Size& frameSize() const { return _frameSize; }
+
+    const Detection* frame(size_t i) const { return _detections.empty() ? NULL : &_detections[0] + _offsets[i]; }
+
+    size_t count(size_t i) const { return _offsets[i + 1] - _offsets[i]; }
+
+private:
+    cv::Size _frameSize;
+    std::vector<Detection> _detections;
+    std::vector<size_t> _offsets;
+};
+
+#endif // DETECTIONCACHE_H
@@ -14,6 +14,8 @@
 ******************************************************************/
 
 #include "Fitting.h"
+#include <algorithm>
+#include <cmath>
 
 #define EPSINON (10e-8)
 
@@ -447,4 +449,262 @@ namespace cvpr {
 
 		return true;
 	}
+
+	CFloorFitting::CFloorFitting(int stride, int iterations, double inlierDist, double forgetting, double lutTolerance)
+		: m_rng(0x5eed)
+	{
+		m_nStride = std::max(stride, 1);
+		m_nIterations = std::max(iterations, 1);
+		m_dInlierDist = inlierDist;
+		m_dForgetting = forgetting;
+		m_dLutTolerance = lutTolerance;
+		m_bInited = false;
+		memset(m_pP, 0, sizeof(m_pP));
+		memset(m_pLutCoef, 0, sizeof(m_pLutCoef));
+	}
+
+	CFloorFitting::~CFloorFitting()
+	{
+	}
+
+	//按步长稀疏采样非零深度点
+	void CFloorFitting::_Sample(const cv::Mat& src)
+	{
+		m_vX.clear();
+		m_vY.clear();
+		m_vZ.clear();
+
+		for (int j = m_nStride / 2; j < src.rows; j += m_nStride)
+		{
+			const uint16_t* data = src.ptr<uint16_t>(j);
+			for (int i = m_nStride / 2; i < src.cols; i += m_nStride)
+			{
+				if (data[i] != 0)
+				{
+					m_vX.push_back(i);
+					m_vY.push_back(j);
+					m_vZ.push_back(data[i]);
+				}
+			}
+		}
+	}
+
+	//过三个采样点的平面 Z = a + b*x + c*y
+	bool CFloorFitting::_FitPlane(const int idx[3], double coef[3]) const
+	{
+		double dx1 = m_vX[idx[1]] - m_vX[idx[0]], dy1 = m_vY[idx[1]] - m_vY[idx[0]], dz1 = m_vZ[idx[1]] - m_vZ[idx[0]];
+		double dx2 = m_vX[idx[2]] - m_vX[idx[0]], dy2 = m_vY[idx[2]] - m_vY[idx[0]], dz2 = m_vZ[idx[2]] - m_vZ[idx[0]];
+
+		double det = dx1 * dy2 - dx2 * dy1;
+		if (fabs(det) < EPSINON)
+		{
+			return false;
+		}
+
+		coef[1] = (dz1 * dy2 - dz2 * dy1) / det;
+		coef[2] = (dx1 * dz2 - dx2 * dz1) / det;
+		coef[0] = m_vZ[idx[0]] - coef[1] * m_vX[idx[0]] - coef[2] * m_vY[idx[0]];
+		return true;
+	}
+
+	bool CFloorFitting::init(const cv::Mat& src)
+	{
+		CV_DbgAssert(!src.empty());
+		CV_DbgAssert(src.type() == CV_16UC1);
+
+		if (src.empty() || src.type() != CV_16UC1)
+		{
+			return false;
+		}
+
+		m_bInited = false;
+
+		_Sample(src);
+		int n = (int)m_vZ.size();
+		if (n < 6)
+		{
+			return false;
+		}
+
+		//RANSAC：地面占画面的大部分，先以平面找出地面点
+		std::vector<int> best;
+		std::vector<int> inliers;
+		for (int it = 0; it < m_nIterations; it++)
+		{
+			int idx[3] = { m_rng.uniform(0, n), m_rng.uniform(0, n), m_rng.uniform(0, n) };
+			double plane[3];
+			if (!_FitPlane(idx, plane))
+			{
+				continue;
+			}
+
+			inliers.clear();
+			for (int k = 0; k < n; k++)
+			{
+				double z = plane[0] + plane[1] * m_vX[k] + plane[2] * m_vY[k];
+				if (fabs(m_vZ[k] - z) <= m_dInlierDist)
+				{
+					inliers.push_back(k);
+				}
+			}
+
+			if (inliers.size() > best.size())
+			{
+				best.swap(inliers);
+			}
+		}
+
+		int nC = (int)best.size();
+		if (nC < 6)
+		{
+			return false;
+		}
+
+		//用地面点拟合二次曲面，并以法方程矩阵的逆作为 RLS 的初值
+		std::vector<int> pX(nC);
+		std::vector<int> pY(nC);
+		std::vector<double> pZ(nC);
+		cv::Mat ata = cv::Mat::zeros(6, 6, CV_64F);
+		for (int i = 0; i < nC; i++)
+		{
+			int k = best[i];
+			pX[i] = m_vX[k];
+			pY[i] = m_vY[k];
+			pZ[i] = m_vZ[k];
+
+			double a1[6] = { 1.0, (double)pX[i], (double)pY[i], (double)pX[i] * pY[i], (double)pX[i] * pX[i], (double)pY[i] * pY[i] };
+			for (int r = 0; r < 6; r++)
+			{
+				double* row = ata.ptr<double>(r);
+				for (int c = 0; c < 6; c++)
+				{
+					row[c] += a1[r] * a1[c];
+				}
+			}
+		}
+
+		if (!_ComputeCoef(nC, &pX[0], &pY[0], &pZ[0], m_pCoefX))
+		{
+			return false;
+		}
+
+		cv::Mat P(6, 6, CV_64F, m_pP);
+		if (cv::invert(ata, P, cv::DECOMP_SVD) <= 0)
+		{
+			return false;
+		}
+
+		_BuildFloor(src.rows, src.cols);
+		m_bInited = true;
+
+		return true;
+	}
+
+	bool CFloorFitting::update(const cv::Mat& src)
+	{
+		if (!m_bInited || src.size() != m_floor.size())
+		{
+			return init(src);
+		}
+
+		if (src.type() != CV_16UC1)
+		{
+			return false;
+		}
+
+		_Sample(src);
+
+		double phi[6], Pphi[6], gain[6];
+		int n = (int)m_vZ.size();
+		for (int k = 0; k < n; k++)
+		{
+			double x = m_vX[k], y = m_vY[k];
+			phi[0] = 1.0;
+			phi[1] = x;
+			phi[2] = y;
+			phi[3] = x * y;
+			phi[4] = x * x;
+			phi[5] = y * y;
+
+			double err = m_vZ[k];
+			for (int i = 0; i < 6; i++)
+			{
+				err -= m_pCoefX[i] * phi[i];
+			}
+
+			//只用地面点更新，人和物体都比地面近
+			if (fabs(err) > m_dInlierDist)
+			{
+				continue;
+			}
+
+			double denom = m_dForgetting;
+			for (int i = 0; i < 6; i++)
+			{
+				Pphi[i] = 0;
+				for (int j = 0; j < 6; j++)
+				{
+					Pphi[i] += m_pP[i * 6 + j] * phi[j];
+				}
+				denom += phi[i] * Pphi[i];
+			}
+
+			for (int i = 0; i < 6; i++)
+			{
+				gain[i] = Pphi[i] / denom;
+				m_pCoefX[i] += gain[i] * err;
+			}
+
+			//P = (P - gain * Pphi') / lambda，P 对称
+			for (int i = 0; i < 6; i++)
+			{
+				for (int j = 0; j < 6; j++)
+				{
+					m_pP[i * 6 + j] = (m_pP[i * 6 + j] - gain[i] * Pphi[j]) / m_dForgetting;
+				}
+			}
+		}
+
+		if (_MaxFloorChange(m_floor.rows, m_floor.cols) > m_dLutTolerance)
+		{
+			_BuildFloor(m_floor.rows, m_floor.cols);
+		}
+
+		return true;
+	}
+
+	//生成逐像素地面深度表
+	void CFloorFitting::_BuildFloor(int rows, int cols)
+	{
+		m_floor.create(rows, cols, CV_16UC1);
+		for (int j = 0; j < rows; j++)
+		{
+			uint16_t* data = m_floor.ptr<uint16_t>(j);
+			for (int i = 0; i < cols; i++)
+			{
+				data[i] = cv::saturate_cast<uint16_t>(_fZX(i, j));
+			}
+		}
+		memcpy(m_pLutCoef, m_pCoefX, sizeof(m_pLutCoef));
+	}
+
+	//当前系数与深度表系数在四角和中心处的最大深度差
+	double CFloorFitting::_MaxFloorChange(int rows, int cols) const
+	{
+		int px[5] = { 0, cols - 1, 0, cols - 1, cols / 2 };
+		int py[5] = { 0, 0, rows - 1, rows - 1, rows / 2 };
+		double maxChange = 0;
+		for (int k = 0; k < 5; k++)
+		{
+			double x = px[k], y = py[k];
+			double phi[6] = { 1.0, x, y, x * y, x * x, y * y };
+			double d = 0;
+			for (int i = 0; i < 6; i++)
+			{
+				d += (m_pCoefX[i] - m_pLutCoef[i]) * phi[i];
+			}
+			maxChange = std::max(maxChange, fabs(d));
+		}
+		return maxChange;
+	}
 }
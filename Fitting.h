@@ -16,6 +16,7 @@
 #pragma once
 
 #include "opencv2/core/core.hpp"
+#include <vector>
 
 namespace cvpr {
 
@@ -45,4 +46,65 @@ namespace cvpr {
         double m_pCoefX[6];
 	};
 
+	/* 地面（背景）模型：首帧用稀疏采样点 + RANSAC 拟合二次曲面，
+	* 之后只用地面点以递推最小二乘（RLS）更新系数，
+	* 并缓存逐像素的地面深度表，求离地高度每像素只需一次减法
+	*/
+	class CFloorFitting : public CFitting
+	{
+	public:
+		/* @param stride: 采样步长（像素）
+		* @param iterations: RANSAC 迭代次数
+		* @param inlierDist: 判定为地面点的最大深度偏差
+		* @param forgetting: RLS 遗忘因子，(0, 1]
+		* @param lutTolerance: 系数变化使地面深度偏差超过该值时才重建深度表
+		*/
+		CFloorFitting(int stride = 8,
+			int iterations = 64,
+			double inlierDist = 30.0,
+			double forgetting = 0.9999,
+			double lutTolerance = 1.0);
+		virtual ~CFloorFitting();
+
+		/* 函数描述: 由一帧深度图（CV_16UC1）初始化地面模型
+		* return: true，拟合成功，否则失败
+		*/
+		bool init(const cv::Mat& src);
+
+		/* 函数描述: 用一帧深度图中的地面点更新地面模型，未初始化时等同于 init
+		* return: true，更新成功，否则失败
+		*/
+		bool update(const cv::Mat& src);
+
+		// 逐像素地面深度表（CV_16UC1）
+		const cv::Mat& floorDepth() const { return m_floor; }
+
+		bool isInited() const { return m_bInited; }
+
+	protected:
+		void _Sample(const cv::Mat& src);
+		bool _FitPlane(const int idx[3], double coef[3]) const;
+		void _BuildFloor(int rows, int cols);
+		double _MaxFloorChange(int rows, int cols) const;
+
+	protected:
+		int m_nStride;
+		int m_nIterations;
+		double m_dInlierDist;
+		double m_dForgetting;
+		double m_dLutTolerance;
+		bool m_bInited;
+
+		// RLS 的逆协方差矩阵
+		double m_pP[36];
+		// 生成地面深度表时的系数
+		double m_pLutCoef[6];
+
+		std::vector<int> m_vX;
+		std::vector<int> m_vY;
+		std::vector<double> m_vZ;
+		cv::RNG m_rng;
+		cv::Mat m_floor;
+	};
+
 }
@@ -0,0 +1,228 @@
+#include "FramePool.h"
+#include "opencv2/core/core_c.h"
+#include <new>
+
+// UMatData headers kept for reuse
+static const size_t MAX_FREE_DATA = 64;
+
+FramePool& FramePool::instance() {
+    static FramePool pool;
+    return pool;
+}
+
+FramePool::FramePool()
+{
+    _maxFree = 8;
+    _maxFreeBytes = 16 << 20;
+    _freeBytes = 0;
+    _useClock = 0;
+    _requests = 0;
+    _hits = 0;
+    _allocations = 0;
+    pthread_mutex_init(&_mutex, NULL);
+}
+
+FramePool::~FramePool() {
+    for (std::map<size_t, FreeList>::iterator it = _free.begin(); it != _free.end(); ++it) {
+        for (size_t i = 0; i < it->second.buffers.size(); ++i) {
+            cv::fastFree(it->second.buffers[i]);
+        }
+    }
+    _free.clear();
+    _freeBytes = 0;
+    for (size_t i = 0; i < _freeData.size(); ++i) {
+        delete _freeData[i];
+    }
+    _freeData.clear();
+    pthread_mutex_destroy(&_mutex);
+}
+
+size_t FramePool::sizeClass(size_t bytes) {
+    if (bytes <= 64) {
+        return 64;
+    }
+
+    // four classes per power of two, at most a quarter is wasted
+    size_t pow2 = 64;
+    while (pow2 * 2 < bytes) {
+        pow2 *= 2;
+    }
+    size_t quarter = pow2 / 4;
+    return (bytes + quarter - 1) / quarter * quarter;
+}
+
+cv::Mat FramePool::acquire(int rows, int cols, int type) {
+    cv::Mat m;
+    m.allocator = this;
+    m.create(rows, cols, type);
+    return m;
+}
+
+void FramePool::adopt(cv::Mat& m) {
+    m.allocator = this;
+}
+
+void FramePool::setMaxFree(size_t maxFree) {
+    pthread_mutex_lock(&_mutex);
+    _maxFree = maxFree;
+    pthread_mutex_unlock(&_mutex);
+}
+
+void FramePool::setMaxFreeBytes(size_t maxFreeBytes) {
+    pthread_mutex_lock(&_mutex);
+    _maxFreeBytes = maxFreeBytes;
+    evict();
+    pthread_mutex_unlock(&_mutex);
+}
+
+void FramePool::evict() const {
+    while (_freeBytes > _maxFreeBytes) {
+        std::map<size_t, FreeList>::iterator oldest = _free.end();
+        for (std::map<size_t, FreeList>::iterator it = _free.begin(); it != _free.end(); ++it) {
+            if (!it->second.buffers.empty() &&
+                (oldest == _free.end() || it->second.lastUse < oldest->second.lastUse)) {
+                oldest = it;
+            }
+        }
+        if (oldest == _free.end()) {
+            break;
+        }
+
+        cv::fastFree(oldest->second.buffers.back());
+        oldest->second.buffers.pop_back();
+        _freeBytes -= oldest->first;
+    }
+}
+
+uint64_t FramePool::requests() const {
+    pthread_mutex_lock(&_mutex);
+    uint64_t n = _requests;
+    pthread_mutex_unlock(&_mutex);
+    return n;
+}
+
+uint64_t FramePool::hits() const {
+    pthread_mutex_lock(&_mutex);
+    uint64_t n = _hits;
+    pthread_mutex_unlock(&_mutex);
+    return n;
+}
+
+uint64_t FramePool::allocations() const {
+    pthread_mutex_lock(&_mutex);
+    uint64_t n = _allocations;
+    pthread_mutex_unlock(&_mutex);
+    return n;
+}
+
+void FramePool::report(std::ostream& os) const {
+    pthread_mutex_lock(&_mutex);
+    uint64_t requests = _requests;
+    uint64_t hits = _hits;
+    uint64_t allocations = _allocations;
+    size_t idle = 0;
+    for (std::map<size_t, FreeList>::const_iterator it = _free.begin(); it != _free.end(); ++it) {
+        idle += it->second.buffers.size();
+    }
+    size_t idleBytes = _freeBytes;
+    pthread_mutex_unlock(&_mutex);
+
+    os << "frame pool: " << requests << " requests, " << hits << " hits ("
+       << (requests ? (int)(hits * 100 / requests) : 0) << "%), "
+       << allocations << " allocations, " << idle << " idle ("
+       << idleBytes / 1024 << " KB)";
+}
+
+cv::UMatData* FramePool::allocate(int dims, const int* sizes, int type,
+                                  void* data0, size_t* step, int /*flags*/, cv::UMatUsageFlags /*usageFlags*/) const {
+    // same layout as OpenCV's default allocator: continuous, no padding
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {
+        if (step) {
+            if (data0 && step[i] != CV_AUTOSTEP) {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            } else {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    uchar* data = (uchar*)data0;
+    cv::UMatData* u = NULL;
+    pthread_mutex_lock(&_mutex);
+    if (!data) {
+        ++_requests;
+        FreeList& idle = _free[sizeClass(total)];
+        idle.lastUse = ++_useClock;
+        if (!idle.buffers.empty()) {
+            data = idle.buffers.back();
+            idle.buffers.pop_back();
+            _freeBytes -= sizeClass(total);
+            ++_hits;
+        } else {
+            ++_allocations;
+        }
+    }
+    if (!_freeData.empty()) {
+        u = _freeData.back();
+        _freeData.pop_back();
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    if (!data) {
+        data = (uchar*)cv::fastMalloc(sizeClass(total));
+    }
+
+    // a recycled UMatData is constructed again in place
+    if (u) {
+        u->~UMatData();
+        new (u) cv::UMatData(this);
+    } else {
+        u = new cv::UMatData(this);
+    }
+    u->data = u->origdata = data;
+    u->size = total;
+    if (data0) {
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+    }
+
+    return u;
+}
+
+bool FramePool::allocate(cv::UMatData* u, int /*accessFlags*/, cv::UMatUsageFlags /*usageFlags*/) const {
+    return u != NULL;
+}
+
+void FramePool::deallocate(cv::UMatData* u) const {
+    if (!u) {
+        return;
+    }
+
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    bool keepData = false;
+    pthread_mutex_lock(&_mutex);
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+        size_t bytes = sizeClass(u->size);
+        FreeList& idle = _free[bytes];
+        if (idle.buffers.size() < _maxFree && bytes <= _maxFreeBytes) {
+            idle.buffers.push_back(u->origdata);
+            _freeBytes += bytes;
+            evict();
+        } else {
+            cv::fastFree(u->origdata);
+        }
+        u->origdata = NULL;
+    }
+    if (_freeData.size() < MAX_FREE_DATA) {
+        _freeData.push_back(u);
+        keepData = true;
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    if (!keepData) {
+        delete u;
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <map>
+#include <ostream>
+#include <vector>
+#include "opencv2/core/core.hpp"
+
+// Image buffers shared by the pipeline stages. The pool is a cv::MatAllocator:
+// a Mat created through it is reference counted by OpenCV as usual, and when
+// its last copy goes away the buffer goes back to the pool instead of the
+// heap, to be handed out again for the next image of the same size class.
+// Sizes are rounded up to classes a quarter of a power of two apart, so
+// buffers whose size changes from frame to frame (a cropped roi, the active
+// tiles) land in a handful of classes, and the idle buffers are capped in
+// total bytes, the least recently used classes evicted first. Once the sizes
+// in use have settled, frames cost no allocations, the UMatData headers are
+// recycled too.
+//
+//     cv::Mat src = FramePool::instance().acquire(240, 320, CV_16UC1);
+//     FramePool::instance().adopt(_mask);   // _mask.create() now uses the pool
+class FramePool : public cv::MatAllocator
+{
+public:
+    static FramePool& instance();
+
+    // A rows x cols Mat of type backed by a pooled buffer, contents undefined.
+    cv::Mat acquire(int rows, int cols, int type);
+
+    // Makes m's future create() calls allocate from the pool, for buffers that
+    // change size from frame to frame. The current buffer is left alone.
+    void adopt(cv::Mat& m);
+
+    // Idle buffers kept per size class, the rest go back to the heap.
+    void setMaxFree(size_t maxFree);
+
+    // Idle bytes kept over all size classes; going over evicts idle buffers of
+    // the least recently used classes. 16 MB by default.
+    void setMaxFreeBytes(size_t maxFreeBytes);
+
+    // Byte count bytes is rounded up to: the next of 1, 1.25, 1.5, 1.75 times
+    // a power of two, at least 64.
+    static size_t sizeClass(size_t bytes);
+
+    // Buffers asked for, how many came from the pool, and how many had to be
+    // allocated from the heap.
+    uint64_t requests() const;
+    uint64_t hits() const;
+    uint64_t allocations() const;
+
+    void report(std::ostream& os) const;
+
+    // cv::MatAllocator
+    cv::UMatData* allocate(int dims, const int* sizes, int type,
+                           void* data, size_t* step, int flags, cv::UMatUsageFlags usageFlags) const;
+    bool allocate(cv::UMatData* data, int accessFlags, cv::UMatUsageFlags usageFlags) const;
+    void deallocate(cv::UMatData* data) const;
+
+private:
+    FramePool();
+    ~FramePool();
+    FramePool(const FramePool&);
+    FramePool& operator=(const FramePool&);
+
+    struct FreeList
+    {
+        std::vector<uchar*> buffers;
+        uint64_t lastUse;
+    };
+
+    // Frees idle buffers of the least recently used classes until the idle
+    // bytes are within _maxFreeBytes. Called with _mutex held.
+    void evict() const;
+
+    size_t _maxFree;
+    size_t _maxFreeBytes;
+
+    // MatAllocator's interface is const, the pool state is not
+    mutable std::map<size_t, FreeList> _free;
+    mutable size_t _freeBytes;
+    mutable uint64_t _useClock;
+    mutable std::vector<cv::UMatData*> _freeData;
+    mutable uint64_t _requests;
+    mutable uint64_t _hits;
+    mutable uint64_t _allocations;
+    mutable pthread_mutex_t _mutex;
+};
+
+#endif // FRAMEPOOL_H
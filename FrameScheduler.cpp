@@ -0,0 +1,42 @@
+#include "FrameScheduler.h"
+
+FrameScheduler::FrameScheduler(int idleStride, double approachDistance, int holdFrames)
+{
+    _idleStride = idleStride > 1 ? idleStride : 1;
+    _approachDistance = approachDistance;
+    _holdFrames = holdFrames > 1 ? holdFrames : 1;
+    reset();
+}
+
+void FrameScheduler::reset() {
+    // start at full rate until the first frames show where the tracks are
+    _hold = _holdFrames;
+    _sinceProcessed = 0;
+    _frames = 0;
+    _processed = 0;
+}
+
+bool FrameScheduler::next() {
+    ++_frames;
+    ++_sinceProcessed;
+    if (_hold == 0 && _sinceProcessed < _idleStride) {
+        return false;
+    }
+
+    _sinceProcessed = 0;
+    ++_processed;
+    return true;
+}
+
+void FrameScheduler::update(const cvb::CvTracks& tracks, const BlobCounter& counter) {
+    for (cvb::CvTracks::const_iterator it = tracks.begin(); it != tracks.end(); ++it) {
+        if (counter.distanceToZones(it->second->centroid) <= _approachDistance) {
+            _hold = _holdFrames;
+            return;
+        }
+    }
+
+    if (_hold > 0) {
+        --_hold;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <stdint.h>
+#include "cvBlob/cvblob.h"
+#include "BlobCounter.h"
+
+// Decides which frames the pipeline processes. While no track is within
+// approachDistance pixels of the counting line or a counting zone only every
+// idleStride-th frame is processed; as soon as one is, every frame is, until
+// holdFrames processed frames in a row had nothing in the band.
+//
+// A track is only seen on processed frames, so approachDistance has to cover
+// what a person moves in idleStride frames, or the first crossings after an
+// idle spell are seen late.
+//
+//     FrameScheduler scheduler(4, 40);
+//     for (;;) {
+//         grab(frame);
+//         if (!scheduler.next()) {
+//             tracker.skipFrame();
+//             continue;
+//         }
+//         tracker.process(...);
+//         scheduler.update(tracker.tracks(), counter);
+//     }
+class FrameScheduler
+{
+public:
+    FrameScheduler(int idleStride = 4, double approachDistance = 40.0, int holdFrames = 8);
+
+    // Call once per incoming frame, true when it has to be processed.
+    bool next();
+
+    // After a processed frame, with the tracks it left.
+    void update(const cvb::CvTracks& tracks, const BlobCounter& counter);
+
+    bool idle() const { return _hold == 0; }
+
+    void reset();
+
+    uint64_t frames() const { return _frames; }
+    uint64_t processed() const { return _processed; }
+
+private:
+    int _idleStride;
+    double _approachDistance;
+    int _holdFrames;
+
+    int _hold;
+    int _sinceProcessed;
+    uint64_t _frames;
+    uint64_t _processed;
+};
+
+#endif // FRAMESCHEDULER_H
@@ -0,0 +1,207 @@
+#include "HeadMinimaExtracter.h"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#define UNKNOWN_DEPTH 65535
+#define RING_SAMPLES 16
+
+HeadMinimaExtracter::HeadMinimaExtracter(int headRadius,
+                                         int minDepth,
+                                         int maxDepth,
+                                         int prominence,
+                                         float minRingFraction,
+                                         int margin)
+{
+    _headRadius = std::max(1, headRadius);
+    _minDepth = minDepth;
+    _maxDepth = maxDepth;
+    _prominence = prominence;
+    _minRingFraction = minRingFraction;
+    _margin = margin;
+
+    for (int i = 0; i < RING_SAMPLES; ++i) {
+        double a = 2*CV_PI*i/RING_SAMPLES;
+        _ring.push_back(cv::Point(cvRound(_headRadius*cos(a)), cvRound(_headRadius*sin(a))));
+    }
+}
+
+void HeadMinimaExtracter::minFilterVertical(const cv::Mat& src, cv::Mat& dst) {
+    int r = _headRadius;
+    int w = 2*r + 1;
+
+    // pad with unknown so every window is exactly w rows long
+    cv::copyMakeBorder(src, _pad, r, r, 0, 0, cv::BORDER_CONSTANT, cv::Scalar(UNKNOWN_DEPTH));
+    int n = _pad.rows;
+    _g.create(_pad.size(), _pad.type());
+    _h.create(_pad.size(), _pad.type());
+
+    // g: running min from the start of each block of w rows, h: from its end.
+    // Every step is one cv::min over a whole row, which OpenCV vectorises.
+    for (int i = 0; i < n; ++i) {
+        cv::Mat g = _g.row(i);
+        if (i % w == 0) {
+            _pad.row(i).copyTo(g);
+        } else {
+            cv::min(_g.row(i - 1), _pad.row(i), g);
+        }
+    }
+
+    for (int i = n - 1; i >= 0; --i) {
+        cv::Mat h = _h.row(i);
+        if (i % w == w - 1 || i == n - 1) {
+            _pad.row(i).copyTo(h);
+        } else {
+            cv::min(_h.row(i + 1), _pad.row(i), h);
+        }
+    }
+
+    // window [y, y + w) of the padded rows = [y - r, y + r] of src
+    dst.create(src.size(), src.type());
+    for (int y = 0; y < src.rows; ++y) {
+        cv::Mat d = dst.row(y);
+        cv::min(_h.row(y), _g.row(y + w - 1), d);
+    }
+}
+
+void HeadMinimaExtracter::minFilter(const cv::Mat& src, cv::Mat& dst) {
+    // separable: columns, then rows through a transpose
+    minFilterVertical(src, _tmp);
+    cv::transpose(_tmp, _transposed);
+    minFilterVertical(_transposed, _filteredT);
+    cv::transpose(_filteredT, dst);
+}
+
+float HeadMinimaExtracter::prominenceScore(const cv::Point& pt, int depth) const {
+    int passed = 0;
+    int samples = 0;
+    float sum = 0;
+
+    for (size_t i = 0; i < _ring.size(); ++i) {
+        cv::Point p = pt + _ring[i];
+        if (p.x < 0 || p.y < 0 || p.x >= _depth.cols || p.y >= _depth.rows) {
+            continue;
+        }
+
+        ++samples;
+        int d = _depth.at<ushort>(p);
+        // unknown or out of range around a head is floor or too far, i.e. deeper
+        if (d == UNKNOWN_DEPTH) {
+            d = _maxDepth;
+        }
+        if (d - depth >= _prominence) {
+            ++passed;
+        }
+        sum += d - depth;
+    }
+
+    if (samples == 0 || passed < _minRingFraction*samples) {
+        return -1;
+    }
+
+    return sum / samples;
+}
+
+void HeadMinimaExtracter::findHeads(const cv::Mat& src) {
+    CV_Assert(src.type() == CV_16UC1);
+
+    // depths outside [_minDepth, _maxDepth] and unknown (0) never win the min
+    _depth.create(src.size(), CV_16UC1);
+    for (int y = 0; y < src.rows; ++y) {
+        const ushort* sptr = src.ptr<ushort>(y);
+        ushort* dptr = _depth.ptr<ushort>(y);
+        for (int x = 0; x < src.cols; ++x) {
+            ushort d = sptr[x];
+            dptr[x] = (d < _minDepth || d > _maxDepth) ? UNKNOWN_DEPTH : d;
+        }
+    }
+
+    minFilter(_depth, _filtered);
+
+    // pixels equal to the min of their window; flat tops give plateaus of them
+    cv::compare(_depth, _filtered, _minima, cv::CMP_EQ);
+    _minima.setTo(0, _depth == UNKNOWN_DEPTH);
+
+    int n = cv::connectedComponentsWithStats(_minima, _labels, _stats, _centroids, 8, CV_32S);
+
+    // one candidate per plateau, at the plateau pixel closest to its centroid
+    _candidates.clear();
+    std::vector<double> best(n, DBL_MAX);
+    std::vector<Candidate> found(n);
+    for (int y = 0; y < _labels.rows; ++y) {
+        const int* lptr = _labels.ptr<int>(y);
+        for (int x = 0; x < _labels.cols; ++x) {
+            int l = lptr[x];
+            if (l == 0) {
+                continue;
+            }
+            double dx = x - _centroids.at<double>(l, 0);
+            double dy = y - _centroids.at<double>(l, 1);
+            if (dx*dx + dy*dy < best[l]) {
+                best[l] = dx*dx + dy*dy;
+                found[l].pt = cv::Point(x, y);
+                found[l].depth = _depth.at<ushort>(y, x);
+            }
+        }
+    }
+
+    for (int l = 1; l < n; ++l) {
+        const cv::Point& pt = found[l].pt;
+        if (pt.x < _margin || pt.y < _margin || pt.x >= src.cols - _margin || pt.y >= src.rows - _margin) {
+            continue;
+        }
+
+        found[l].score = prominenceScore(pt, found[l].depth);
+        if (found[l].score >= 0) {
+            _candidates.push_back(found[l]);
+        }
+    }
+
+    // strongest first, nothing closer than 1.5 head radii to a kept head
+    std::sort(_candidates.begin(), _candidates.end(), higherScore);
+
+    int minDist2 = (3*_headRadius/2)*(3*_headRadius/2);
+    _heads.clear();
+    for (size_t i = 0; i < _candidates.size(); ++i) {
+        bool suppressed = false;
+        for (size_t j = 0; j < _heads.size(); ++j) {
+            cv::Point d = _candidates[i].pt - _heads[j].pt;
+            if (d.dot(d) < minDist2) {
+                suppressed = true;
+                break;
+            }
+        }
+        if (!suppressed) {
+            _heads.push_back(_candidates[i]);
+        }
+    }
+}
+
+bool HeadMinimaExtracter::detects(const cv::Mat& src, std::vector<Detection>& detections, bool withRuns) {
+    findHeads(src);
+
+    // heads only have to be _margin from the edge, which can be less than
+    // _headRadius: the square is clipped so its corner is never negative
+    cv::Rect frame(0, 0, src.cols, src.rows);
+    detections.resize(_heads.size());
+    for (size_t i = 0; i < _heads.size(); ++i) {
+        Detection& det = detections[i];
+        const cv::Point& pt = _heads[i].pt;
+        det.bbox = cv::Rect(pt.x - _headRadius, pt.y - _headRadius, 2*_headRadius, 2*_headRadius) & frame;
+        det.centroid = cv::Point2d(pt.x, pt.y);
+        det.area = CV_PI*_headRadius*_headRadius;
+        det.runs.clear();
+    }
+
+    return true;
+}
+
+void HeadMinimaExtracter::extracts(const cv::Mat& src, cv::Mat& dst) {
+    findHeads(src);
+
+    dst.setTo(0);
+    for (size_t i = 0; i < _heads.size(); ++i) {
+        cv::circle(dst, _heads[i].pt, _headRadius, cv::Scalar(255), -1);
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef HEADMINIMAEXTRACTER_H
+#define HEADMINIMAEXTRACTER_H
+
+#include "opencv2/core/core.hpp"
+#include "IExtracter.h"
+#include <vector>
+
+// Finds heads under an overhead depth camera directly as local minima of the
+// distance: a (2*headRadius+1)^2 min filter (van Herk/Gil-Werman, a constant
+// number of vectorised row minimums per pixel whatever the radius), pixels
+// equal to their filtered value grouped into plateaus, a prominence test
+// against a ring of headRadius around each plateau and a greedy non-maximum
+// suppression. The cost is a few passes over the frame, independent of the
+// depth range.
+class HeadMinimaExtracter : public IExtracter
+{
+public:
+    HeadMinimaExtracter(int headRadius = 10,
+                        int minDepth = 400,
+                        int maxDepth = 2000,
+                        int prominence = 100,
+                        float minRingFraction = 0.75,
+                        int margin = 5);
+
+    // Draws a filled disc of headRadius per head.
+    void extracts(const cv::Mat& src, cv::Mat& dst);
+
+    // One detection per head, a 2*headRadius square around the minimum clipped
+    // to the frame. No runs.
+    bool detects(const cv::Mat& src, std::vector<Detection>& detections, bool withRuns = false);
+
+private:
+    struct Candidate
+    {
+        cv::Point pt;
+        int depth;
+        float score;
+    };
+
+    static bool higherScore(const Candidate& a, const Candidate& b) { return a.score > b.score; }
+
+    // Min over a (2*_headRadius+1) tall window for every column.
+    void minFilterVertical(const cv::Mat& src, cv::Mat& dst);
+
+    void minFilter(const cv::Mat& src, cv::Mat& dst);
+
+    // Mean ring depth above the candidate, < 0 when the ring test fails.
+    float prominenceScore(const cv::Point& pt, int depth) const;
+
+    void findHeads(const cv::Mat& src);
+
+    int _headRadius;
+    int _minDepth;
+    int _maxDepth;
+    int _prominence;
+    float _minRingFraction;
+    int _margin;
+
+    std::vector<cv::Point> _ring;
+    std::vector<Candidate> _candidates;
+    std::vector<Candidate> _heads;
+
+    cv::Mat _depth;
+    cv::Mat _pad;
+    cv::Mat _g;
+    cv::Mat _h;
+    cv::Mat _tmp;
+    cv::Mat _transposed;
+    cv::Mat _filteredT;
+    cv::Mat _filtered;
+    cv::Mat _minima;
+    cv::Mat _labels;
+    cv::Mat _stats;
+    cv::Mat _centroids;
+};
+
+#endif // HEADMINIMAEXTRACTER_H
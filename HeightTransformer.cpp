@@ -0,0 +1,111 @@
+#include "HeightTransformer.h"
+#include "opencv2/core/core_c.h"
+
+HeightTransformer::HeightTransformer(int maxHeight, int referenceHeight)
+{
+    _maxHeight = maxHeight;
+    _referenceHeight = referenceHeight;
+    _updateInterval = 25;
+    _floorBand = 30;
+    _frameNo = 0;
+}
+
+void HeightTransformer::setFloor(const cv::Mat& floor) {
+    assert(floor.type() == CV_16UC1);
+    // 不写进现有缓冲区，它可能是拟合器的地面深度表
+    _floor = floor.clone();
+}
+
+bool HeightTransformer::fitFloor(const cv::Mat& src) {
+    if (!_fitting.init(src)) {
+        return false;
+    }
+
+    // 与拟合器共用地面深度表，更新后重建的表直接生效
+    _floor = _fitting.floorDepth();
+    return true;
+}
+
+void HeightTransformer::setFloorUpdate(int updateInterval, int floorBand) {
+    _updateInterval = updateInterval;
+    _floorBand = floorBand;
+}
+
+bool HeightTransformer::loadFloor(const char* file) {
+    CvFileStorage* fs = cvOpenFileStorage(file, 0, CV_STORAGE_READ);
+    if (!fs) {
+        return false;
+    }
+
+    CvMat* floor = (CvMat*)cvReadByName(fs, 0, "floor");
+    if (floor) {
+        _floor = cv::Mat(floor).clone();
+        cvReleaseMat(&floor);
+    }
+
+    cvReleaseFileStorage(&fs);
+
+    return hasFloor() && _floor.type() == CV_16UC1;
+}
+
+void HeightTransformer::saveFloor(const char* file) const {
+    if (!hasFloor()) {
+        return;
+    }
+
+    CvFileStorage* fs = cvOpenFileStorage(file, 0, CV_STORAGE_WRITE);
+    if (!fs) {
+        return;
+    }
+
+    CvMat floor = _floor;
+    cvWrite(fs, "floor", &floor);
+
+    cvReleaseFileStorage(&fs);
+}
+
+void HeightTransformer::preprocess(const cv::Mat& src, cv::Mat& dst, const cv::Point& offset) {
+
+    assert(src.type() == CV_16UC1);
+
+    // 没有地面模型、或 src 不在模型范围内时原样输出
+    cv::Rect part(offset, src.size());
+    if (!hasFloor() || (part & cv::Rect(0, 0, _floor.cols, _floor.rows)) != part) {
+        if (dst.data != src.data) {
+            src.copyTo(dst);
+        }
+        return;
+    }
+
+    cv::Mat floor = _floor(part);
+
+    // 先记下无效像素，dst 可能就是 src
+    cv::compare(src, 0, _unknown, cv::CMP_EQ);
+
+    // 隔帧取出离地面 _floorBand 以内的像素，变换完后用它们更新地面模型
+    bool update = _updateInterval > 0 && ++_frameNo % _updateInterval == 0;
+    if (update) {
+        cv::absdiff(src, floor, _diff);
+        cv::compare(_diff, cv::Scalar(_floorBand), _floorMask, cv::CMP_LE);
+        _floorMask.setTo(0, _unknown);
+        // 拟合器按整帧坐标，区域外没有地面点
+        _floorPixels.create(_floor.size(), CV_16UC1);
+        _floorPixels.setTo(0);
+        cv::Mat floorPart = _floorPixels(part);
+        src.copyTo(floorPart, _floorMask);
+    }
+
+    // 全部用 OpenCV 的向量化算子：16 位饱和减法把地面以下的像素截为 0
+    cv::subtract(floor, src, dst);
+    cv::min(dst, cv::Scalar(_maxHeight), dst);
+    if (_referenceHeight > 0) {
+        cv::subtract(cv::Scalar(_referenceHeight), dst, dst);
+    }
+
+    dst.setTo(0, _unknown);
+
+    // 模型由文件载入时，第一次更新先用这些地面点初始化拟合器
+    if (update && _fitting.update(_floorPixels)) {
+        _floor = _fitting.floorDepth();
+    }
+}
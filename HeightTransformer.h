@@ -0,0 +1,62 @@
+#ifndef HEIGHTTRANSFORMER_H
+#define HEIGHTTRANSFORMER_H
+
+#include "opencv2/core/core.hpp"
+#include "IPreprocessor.h"
+#include "Fitting.h"
+
+// Converts raw camera depth into height above a stored per-pixel floor model
+// (e.g. cvpr::CFloorFitting::floorDepth()), so extracter layers become flat
+// height bands whatever the install height and tilt.
+//
+// With referenceHeight > 0 the output is referenceHeight - height, i.e. the
+// depth an untilted camera mounted referenceHeight above the floor would see,
+// which keeps the extracters' near-to-far slicing unchanged.
+// Unknown (zero) depth stays zero.
+//
+// Every updateInterval frames the pixels within floorBand of the floor are
+// fed to a cvpr::CFloorFitting, whose recursive least squares update keeps
+// the floor model following slow drift of the camera.
+class HeightTransformer : public IPreprocessor
+{
+public:
+    HeightTransformer(int maxHeight = 2500, int referenceHeight = 0);
+
+    // src may be the part of the frame starting at offset; the floor model
+    // stays in frame coordinates.
+    void preprocess(const cv::Mat& src, cv::Mat& dst, const cv::Point& offset = cv::Point());
+
+    void setFloor(const cv::Mat& floor);
+
+    // Fits the floor model on a frame showing mostly floor.
+    bool fitFloor(const cv::Mat& src);
+
+    // updateInterval <= 0 keeps the floor model fixed.
+    void setFloorUpdate(int updateInterval = 25, int floorBand = 30);
+
+    void setReferenceHeight(int referenceHeight) { _referenceHeight = referenceHeight; }
+
+    const cv::Mat& floor() const { return _floor; }
+
+    bool hasFloor() const { return !_floor.empty(); }
+
+    bool loadFloor(const char* file = "config/FloorModel.xml");
+
+    void saveFloor(const char* file = "config/FloorModel.xml") const;
+
+private:
+    cv::Mat _floor;
+    cv::Mat _unknown;
+    int _maxHeight;
+    int _referenceHeight;
+
+    cvpr::CFloorFitting _fitting;
+    int _updateInterval;
+    int _floorBand;
+    int _frameNo;
+    cv::Mat _diff;
+    cv::Mat _floorMask;
+    cv::Mat _floorPixels;
+};
+
+#endif // HEIGHTTRANSFORMER_H
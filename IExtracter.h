@@ -2,10 +2,16 @@
 #define IEXTRACTER_H
 
 #include "opencv2/core/core.hpp"
+#include "Detection.h"
 
 class IExtracter {
 public:
     virtual void extracts(const cv::Mat& src, cv::Mat& dst) {}
+
+    // Returns the blobs as a list instead of a mask, so they can be handed to
+    // BlobTracker::process(detections) without rasterising and relabelling.
+    // Returns false when the extracter does not support it.
+    virtual bool detects(const cv::Mat& src, std::vector<Detection>& detections, bool withRuns = false) { return false; }
 };
 
 #endif // IEXTRACTER_H
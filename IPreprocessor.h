@@ -0,0 +1,15 @@
+#ifndef IPREPROCESSOR_H
+#define IPREPROCESSOR_H
+
+#include "opencv2/core/core.hpp"
+
+// A depth frame stage run before the extracters. src and dst may be the same
+// Mat, stages are chained in place. src may be a part of the frame (e.g. the
+// processing roi), offset is then where it starts in the frame, for stages
+// whose state is in frame coordinates.
+class IPreprocessor {
+public:
+    virtual void preprocess(const cv::Mat& src, cv::Mat& dst, const cv::Point& offset = cv::Point()) {}
+};
+
+#endif // IPREPROCESSOR_H
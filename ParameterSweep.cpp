@@ -0,0 +1,93 @@
+#include "ParameterSweep.h"
+#include "BlobTracker.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+ParameterSweep::ParameterSweep(const DetectionCache& cache, int goldenIn, int goldenOut)
+    : _cache(cache)
+{
+    _goldenIn = goldenIn;
+    _goldenOut = goldenOut;
+}
+
+void ParameterSweep::evaluate(const SweepConfig& config, SweepResult& result) const {
+    BlobCounter counter;
+    counter.init(_cache.frameSize(), config.rectScale, config.lineStatus, config.ioDirection, config.distanceThreshold);
+    for (size_t i = 0; i < config.zones.size(); ++i) {
+        counter.addCountingZone(config.zones[i]);
+    }
+
+    BlobTracker tracker(&counter);
+    tracker.init(1.0f, config.maxMatchDistance, config.inactiveFrame, config.activeFrame);
+
+    for (size_t i = 0; i < _cache.frames(); ++i) {
+        tracker.process(_cache.frame(i), _cache.count(i));
+    }
+
+    result.iPeople = counter._iPeople;
+    result.oPeople = counter._oPeople;
+    result.zoneIn.clear();
+    result.zoneOut.clear();
+    const std::vector<CountingZone>& zones = counter.countingZones();
+    for (size_t i = 0; i < zones.size(); ++i) {
+        result.zoneIn.push_back(zones[i].iPeople);
+        result.zoneOut.push_back(zones[i].oPeople);
+    }
+    result.error = abs(result.iPeople - _goldenIn) + abs(result.oPeople - _goldenOut);
+}
+
+void* ParameterSweep::thread_Sweep(void* arg) {
+    SweepJob* job = (SweepJob*)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&job->mutex);
+        int i = job->next++;
+        pthread_mutex_unlock(&job->mutex);
+
+        if (i >= (int)job->configs->size()) {
+            break;
+        }
+
+        job->sweep->evaluate((*job->configs)[i], (*job->results)[i]);
+    }
+
+    return NULL;
+}
+
+void ParameterSweep::run(const std::vector<SweepConfig>& configs, std::vector<SweepResult>& results, int numThreads) {
+    results.assign(configs.size(), SweepResult());
+
+    SweepJob job;
+    job.sweep = this;
+    job.configs = &configs;
+    job.results = &results;
+    job.next = 0;
+    job.mutex = (pthread_mutex_t)PTHREAD_MUTEX_INITIALIZER;
+
+    // 当前线程也参与计算
+    std::vector<pthread_t> tIds;
+    for (int i = 1; i < numThreads; ++i) {
+        pthread_t tId;
+        if (pthread_create(&tId, NULL, ParameterSweep::thread_Sweep, &job) == 0) {
+            tIds.push_back(tId);
+        }
+    }
+
+    thread_Sweep(&job);
+
+    for (size_t i = 0; i < tIds.size(); ++i) {
+        pthread_join(tIds[i], 0);
+    }
+
+    pthread_mutex_destroy(&job.mutex);
+}
+
+int ParameterSweep::best(const std::vector<SweepResult>& results) {
+    int index = -1;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (index < 0 || results[i].error < results[index].error) {
+            index = i;
+        }
+    }
+    return index;
+}
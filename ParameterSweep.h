@@ -0,0 +1,65 @@
+#ifndef PARAMETERSWEEP_H
+#define PARAMETERSWEEP_H
+
+#include "DetectionCache.h"
+#include "BlobCounter.h"
+#include <pthread.h>
+#include <vector>
+
+// One tracker + counter setting to evaluate, see BlobTracker::init() and
+// BlobCounter::init().
+typedef struct SweepConfig
+{
+    float maxMatchDistance;
+    uint inactiveFrame;
+    uint activeFrame;
+
+    RectScale rectScale;
+    int lineStatus;
+    int ioDirection;
+    double distanceThreshold;
+
+    std::vector<CountingZone> zones;
+} SweepConfig;
+
+typedef struct SweepResult
+{
+    int iPeople;
+    int oPeople;
+    std::vector<int> zoneIn;
+    std::vector<int> zoneOut;
+    int error;                      // |in - golden in| + |out - golden out| of the main line
+} SweepResult;
+
+// Replays a DetectionCache through a fresh BlobTracker/BlobCounter pair per
+// configuration, the configurations spread over numThreads threads.
+class ParameterSweep
+{
+public:
+    ParameterSweep(const DetectionCache& cache, int goldenIn, int goldenOut);
+
+    void run(const std::vector<SweepConfig>& configs, std::vector<SweepResult>& results, int numThreads = 4);
+
+    // Index of the configuration with the smallest error, -1 if there is none.
+    static int best(const std::vector<SweepResult>& results);
+
+    void evaluate(const SweepConfig& config, SweepResult& result) const;
+
+private:
+    struct SweepJob
+    {
+        const ParameterSweep* sweep;
+        const std::vector<SweepConfig>* configs;
+        std::vector<SweepResult>* results;
+        int next;
+        pthread_mutex_t mutex;
+    };
+
+    static void* thread_Sweep(void* arg);
+
+    const DetectionCache& _cache;
+    int _goldenIn;
+    int _goldenOut;
+};
+
+#endif // PARAMETERSWEEP_H
@@ -0,0 +1,50 @@
+#ifndef STAGEPIXELS_H
+#define STAGEPIXELS_H
+
+#include <stdint.h>
+#include <ostream>
+
+// Pixels each pipeline stage went through, summed over frames, to see what
+// restricting the pipeline to BlobCounter::processingRoi() saves. Stages add
+// to it through their setStagePixels(); fullFrame is what a full-frame pass
+// of one stage would have cost.
+struct StagePixels
+{
+    uint64_t frames;
+    uint64_t fullFrame;
+    uint64_t capture;     // depth pixels resampled from the camera frame
+    uint64_t threshold;   // layer pixels thresholded (all layers)
+    uint64_t labelling;   // layer pixels labelled (all layers)
+    uint64_t tracking;    // mask pixels labelled by the tracker
+
+    StagePixels() { reset(); }
+
+    void reset() {
+        frames = fullFrame = capture = threshold = labelling = tracking = 0;
+    }
+
+    void addFrame(uint64_t framePixels) {
+        ++frames;
+        fullFrame += framePixels;
+    }
+
+    // Average pixels per frame of each stage, with the fraction of a full frame
+    // for the single-pass stages.
+    void report(std::ostream& os) const {
+        if (frames == 0) {
+            return;
+        }
+        os << "pixels/frame: full " << fullFrame / frames
+           << ", capture " << capture / frames << " (" << percent(capture) << "%)"
+           << ", threshold " << threshold / frames
+           << ", labelling " << labelling / frames
+           << ", tracking " << tracking / frames << " (" << percent(tracking) << "%)";
+    }
+
+private:
+    int percent(uint64_t pixels) const {
+        return fullFrame ? (int)(pixels * 100 / fullFrame) : 0;
+    }
+};
+
+#endif // STAGEPIXELS_H
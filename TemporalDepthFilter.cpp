@@ -0,0 +1,126 @@
+#include "TemporalDepthFilter.h"
+#include <algorithm>
+#include <cmath>
+
+TemporalDepthFilter::TemporalDepthFilter(float alpha,
+                                         int holdFrames,
+                                         int jumpThreshold,
+                                         int edgeThreshold,
+                                         int fillIterations)
+{
+    _alpha = alpha;
+    _holdFrames = std::min(std::max(holdFrames, 0), 254);
+    _jumpThreshold = jumpThreshold;
+    _edgeThreshold = edgeThreshold;
+    _fillIterations = fillIterations;
+}
+
+void TemporalDepthFilter::reset() {
+    _ema.release();
+    _age.release();
+}
+
+void TemporalDepthFilter::preprocess(const cv::Mat& src, cv::Mat& dst, const cv::Point& offset) {
+
+    assert(src.type() == CV_16UC1);
+
+    if (_ema.size() != src.size()) {
+        _ema = cv::Mat::zeros(src.size(), CV_32FC1);
+        _age = cv::Mat::zeros(src.size(), CV_8UC1);
+    }
+
+    dst.create(src.size(), CV_16UC1);
+    // 填洞时读的邻域副本，这里同时写入，不用再整帧拷贝
+    _fill.create(src.size(), CV_16UC1);
+    _holeRows.clear();
+
+    int hold = _holdFrames;
+    float jump = (float)_jumpThreshold;
+    for (int i = 0; i < src.rows; ++i) {
+        const ushort* sptr = src.ptr<ushort>(i);
+        float* eptr = _ema.ptr<float>(i);
+        uchar* aptr = _age.ptr<uchar>(i);
+        ushort* dptr = dst.ptr<ushort>(i);
+        ushort* fptr = _fill.ptr<ushort>(i);
+        bool holes = false;
+        for (int j = 0; j < src.cols; ++j) {
+            float d = sptr[j];
+            float e = eptr[j];
+            if (d != 0) {
+                // 没有历史值或深度突变（有人进出）时直接取当前值
+                e = (e == 0 || std::abs(d - e) > jump) ? d : e + _alpha * (d - e);
+                aptr[j] = 0;
+            } else if (aptr[j] < hold) {
+                // 空洞在 hold 帧内沿用上一次的值
+                ++aptr[j];
+            } else {
+                e = 0;
+            }
+            eptr[j] = e;
+            dptr[j] = fptr[j] = (ushort)(e + 0.5f);
+            holes |= dptr[j] == 0;
+        }
+        if (holes) {
+            _holeRows.push_back(i);
+        }
+    }
+
+    fillHoles(dst);
+}
+
+void TemporalDepthFilter::fillHoles(cv::Mat& dst) {
+
+    // _fill 与 dst 内容一致，每轮从 _fill 读邻域、往 dst 写，再只把填上的像素同步回 _fill；
+    // 只处理还有空洞的行
+    int rows = dst.rows, cols = dst.cols;
+    for (int it = 0; it < _fillIterations && !_holeRows.empty(); ++it) {
+        _filled.clear();
+
+        size_t kept = 0;
+        for (size_t r = 0; r < _holeRows.size(); ++r) {
+            int i = _holeRows[r];
+            const ushort* up = _fill.ptr<ushort>(std::max(i - 1, 0));
+            const ushort* mid = _fill.ptr<ushort>(i);
+            const ushort* down = _fill.ptr<ushort>(std::min(i + 1, rows - 1));
+            ushort* dptr = dst.ptr<ushort>(i);
+            bool holes = false;
+            for (int j = 0; j < cols; ++j) {
+                if (mid[j] != 0) {
+                    continue;
+                }
+
+                ushort nbrs[4] = { up[j], down[j],
+                                   mid[std::max(j - 1, 0)], mid[std::min(j + 1, cols - 1)] };
+                int n = 0, sum = 0, lo = 0xFFFF, hi = 0;
+                for (int k = 0; k < 4; ++k) {
+                    if (nbrs[k] != 0) {
+                        ++n;
+                        sum += nbrs[k];
+                        lo = std::min(lo, (int)nbrs[k]);
+                        hi = std::max(hi, (int)nbrs[k]);
+                    }
+                }
+
+                if (n == 0) {
+                    holes = true;
+                    continue;
+                }
+
+                // 邻域跨越边缘时取最远的值，避免团块向背景膨胀
+                dptr[j] = (hi - lo <= _edgeThreshold) ? (ushort)((sum + n/2) / n) : (ushort)hi;
+                _filled.push_back(cv::Point(j, i));
+            }
+            if (holes) {
+                _holeRows[kept++] = i;
+            }
+        }
+        _holeRows.resize(kept);
+
+        if (_filled.empty()) {
+            break;
+        }
+        for (size_t k = 0; k < _filled.size(); ++k) {
+            _fill.at<ushort>(_filled[k]) = dst.at<ushort>(_filled[k]);
+        }
+    }
+}
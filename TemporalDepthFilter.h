@@ -0,0 +1,46 @@
+#ifndef TEMPORALDEPTHFILTER_H
+#define TEMPORALDEPTHFILTER_H
+
+#include "opencv2/core/core.hpp"
+#include "IPreprocessor.h"
+#include <vector>
+
+// Streaming depth denoiser run before DepthBlobsExtracter:
+//  - per-pixel exponential moving average, restarted when the depth jumps by
+//    more than jumpThreshold so moving people do not leave trails;
+//  - a pixel that drops to zero keeps its last value for holdFrames frames;
+//  - remaining holes are filled from their 4-neighbours, with the mean when
+//    the neighbours agree within edgeThreshold and with the farthest one when
+//    they straddle an edge, so blobs are not grown into the background.
+// State is one float and one byte per pixel.
+class TemporalDepthFilter : public IPreprocessor
+{
+public:
+    TemporalDepthFilter(float alpha = 0.5,
+                        int holdFrames = 3,
+                        int jumpThreshold = 60,
+                        int edgeThreshold = 40,
+                        int fillIterations = 2);
+
+    // The state follows src's size, offset is not used.
+    void preprocess(const cv::Mat& src, cv::Mat& dst, const cv::Point& offset = cv::Point());
+
+    void reset();
+
+private:
+    void fillHoles(cv::Mat& dst);
+
+    float _alpha;
+    int _holdFrames;
+    int _jumpThreshold;
+    int _edgeThreshold;
+    int _fillIterations;
+
+    cv::Mat _ema;
+    cv::Mat _age;
+    cv::Mat _fill;
+    std::vector<int> _holeRows;
+    std::vector<cv::Point> _filled;
+};
+
+#endif // TEMPORALDEPTHFILTER_H
@@ -0,0 +1,99 @@
+#include "TrackGapFiller.h"
+#include "spline.h"
+
+TrackGapFiller::TrackGapFiller(int samples)
+{
+    _samples = samples > 2 ? samples : 2;
+}
+
+void TrackGapFiller::add(cvb::CvID id, unsigned int frame, const CvPoint2D64f& centroid) {
+    std::deque<Sample>& history = _history[id];
+    // a track is matched once per frame, keep the latest position
+    if (!history.empty() && history.back().frame >= frame) {
+        history.back().centroid = centroid;
+        return;
+    }
+
+    Sample sample;
+    sample.frame = frame;
+    sample.centroid = centroid;
+    history.push_back(sample);
+    if ((int)history.size() > _samples) {
+        history.pop_front();
+    }
+}
+
+void TrackGapFiller::fill(cvb::CvID id, std::vector<CvPoint2D64f>& points) const {
+    points.clear();
+
+    std::map<cvb::CvID, std::deque<Sample> >::const_iterator it = _history.find(id);
+    if (it == _history.end() || it->second.size() < 2) {
+        return;
+    }
+
+    const std::deque<Sample>& history = it->second;
+    const Sample& from = history[history.size() - 2];
+    const Sample& to = history.back();
+    if (to.frame - from.frame < 2) {
+        return;
+    }
+
+    if (history.size() == 2) {
+        double span = to.frame - from.frame;
+        for (unsigned int f = from.frame + 1; f < to.frame; ++f) {
+            double t = (f - from.frame) / span;
+            points.push_back(cvPoint2D64f(from.centroid.x + t*(to.centroid.x - from.centroid.x),
+                                          from.centroid.y + t*(to.centroid.y - from.centroid.y)));
+        }
+        return;
+    }
+
+    std::vector<double> frames, xs, ys;
+    for (size_t i = 0; i < history.size(); ++i) {
+        frames.push_back(history[i].frame);
+        xs.push_back(history[i].centroid.x);
+        ys.push_back(history[i].centroid.y);
+    }
+
+    tk::spline sx, sy;
+    sx.set_points(frames, xs);
+    sy.set_points(frames, ys);
+    for (unsigned int f = from.frame + 1; f < to.frame; ++f) {
+        points.push_back(cvPoint2D64f(sx(f), sy(f)));
+    }
+}
+
+bool TrackGapFiller::velocity(cvb::CvID id, CvPoint2D64f& v) const {
+    v = cvPoint2D64f(0, 0);
+
+    std::map<cvb::CvID, std::deque<Sample> >::const_iterator it = _history.find(id);
+    if (it == _history.end() || it->second.size() < 2) {
+        return false;
+    }
+
+    const std::deque<Sample>& history = it->second;
+    const Sample& from = history[history.size() - 2];
+    const Sample& to = history.back();
+    double span = to.frame - from.frame;
+    v.x = (to.centroid.x - from.centroid.x) / span;
+    v.y = (to.centroid.y - from.centroid.y) / span;
+    return true;
+}
+
+void TrackGapFiller::remove(cvb::CvID id) {
+    _history.erase(id);
+}
+
+void TrackGapFiller::prune(const cvb::CvTracks& tracks) {
+    for (std::map<cvb::CvID, std::deque<Sample> >::iterator it = _history.begin(); it != _history.end();) {
+        if (tracks.find(it->first) == tracks.end()) {
+            _history.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void TrackGapFiller::clear() {
+    _history.clear();
+}
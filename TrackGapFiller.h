@@ -0,0 +1,46 @@
+#ifndef TRACKGAPFILLER_H
+#define TRACKGAPFILLER_H
+
+#include <deque>
+#include <map>
+#include <vector>
+#include "cvBlob/cvblob.h"
+
+// Last few centroids of each track with the frame they were seen in. When a
+// track shows up again after skipped frames, fill() interpolates where it was
+// in between: a cubic spline (tk::spline, per coordinate over the frame
+// number) through the kept samples, a straight line while there are only two.
+class TrackGapFiller
+{
+public:
+    explicit TrackGapFiller(int samples = 4);
+
+    void add(cvb::CvID id, unsigned int frame, const CvPoint2D64f& centroid);
+
+    // Positions of track id for the frames between its last two samples,
+    // oldest first; nothing when they are consecutive.
+    void fill(cvb::CvID id, std::vector<CvPoint2D64f>& points) const;
+
+    // Displacement of track id per frame between its last two samples;
+    // false (and zero) while it has fewer than two.
+    bool velocity(cvb::CvID id, CvPoint2D64f& v) const;
+
+    void remove(cvb::CvID id);
+
+    // drop every track that is no longer in tracks
+    void prune(const cvb::CvTracks& tracks);
+
+    void clear();
+
+private:
+    struct Sample
+    {
+        unsigned int frame;
+        CvPoint2D64f centroid;
+    };
+
+    int _samples;
+    std::map<cvb::CvID, std::deque<Sample> > _history;
+};
+
+#endif // TRACKGAPFILLER_H
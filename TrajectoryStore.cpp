@@ -0,0 +1,81 @@
+#include "TrajectoryStore.h"
+
+TrajectoryStore::TrajectoryStore(int capacity) : capacity(capacity > 0 ? capacity : 1)
+{
+}
+
+void TrajectoryStore::append(cvb::CvID id, const CvPoint2D64f &point)
+{
+    int s;
+    std::map<cvb::CvID, int>::iterator it = index.find(id);
+    if(it != index.end())
+    {
+        s = it->second;
+    }
+    else
+    {
+        if(!freeSlots.empty())
+        {
+            s = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else
+        {
+            s = (int)slots.size();
+            slots.push_back(Slot());
+            points.resize(slots.size()*capacity);
+        }
+
+        slots[s].head = capacity - 1;
+        slots[s].count = 0;
+        index.insert(std::pair<cvb::CvID, int>(id, s));
+    }
+
+    Slot &slot = slots[s];
+    slot.head = slot.head + 1 == capacity ? 0 : slot.head + 1;
+    points[s*capacity + slot.head] = point;
+    if(slot.count < capacity)
+        slot.count++;
+}
+
+void TrajectoryStore::remove(cvb::CvID id)
+{
+    std::map<cvb::CvID, int>::iterator it = index.find(id);
+    if(it == index.end())
+        return;
+
+    freeSlots.push_back(it->second);
+    index.erase(it);
+}
+
+TrajectoryView TrajectoryStore::view(cvb::CvID id) const
+{
+    std::map<cvb::CvID, int>::const_iterator it = index.find(id);
+    if(it == index.end())
+        return TrajectoryView();
+
+    const Slot &slot = slots[it->second];
+    return TrajectoryView(&points[it->second*capacity], capacity, slot.head, slot.count);
+}
+
+void TrajectoryStore::prune(const cvb::CvTracks &tracks)
+{
+    for(std::map<cvb::CvID, int>::iterator it = index.begin(); it != index.end();)
+    {
+        if(tracks.count(it->first) == 0)
+        {
+            freeSlots.push_back(it->second);
+            index.erase(it++);
+        }
+        else
+            ++it;
+    }
+}
+
+void TrajectoryStore::clear()
+{
+    index.clear();
+    freeSlots.clear();
+    for(int s = (int)slots.size() - 1; s >= 0; s--)
+        freeSlots.push_back(s);
+}
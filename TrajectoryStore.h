@@ -0,0 +1,67 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "cvBlob/cvblob.h"
+
+// Read-only view of one track's history, newest point first. Points live in
+// the store, so a view is only valid until the next append/remove.
+class TrajectoryView
+{
+public:
+    TrajectoryView() : data(0), capacity(0), head(0), count(0) {}
+    TrajectoryView(const CvPoint2D64f* d, int cap, int h, int n) : data(d), capacity(cap), head(h), count(n) {}
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // i = 0 is the newest point
+    const CvPoint2D64f& operator[](int i) const
+    {
+        int k = head - i;
+        if(k < 0)
+            k += capacity;
+        return data[k];
+    }
+
+    const CvPoint2D64f& newest() const { return (*this)[0]; }
+    const CvPoint2D64f& oldest() const { return (*this)[count - 1]; }
+
+private:
+    const CvPoint2D64f* data;
+    int capacity;
+    int head;
+    int count;
+};
+
+// Per-track trajectories in one contiguous block: every slot is a ring of
+// `capacity` points, slots are recycled when their track goes away.
+class TrajectoryStore
+{
+public:
+    explicit TrajectoryStore(int capacity = 30);
+
+    void append(cvb::CvID id, const CvPoint2D64f &point);
+    void remove(cvb::CvID id);
+    bool contains(cvb::CvID id) const { return index.count(id) > 0; }
+    TrajectoryView view(cvb::CvID id) const;
+
+    // drop the history of every track that is no longer in tracks
+    void prune(const cvb::CvTracks &tracks);
+
+    void clear();
+
+private:
+    struct Slot
+    {
+        int head;
+        int count;
+    };
+
+    int capacity;
+    std::vector<CvPoint2D64f> points;
+    std::vector<Slot> slots;
+    std::vector<int> freeSlots;
+    std::map<cvb::CvID, int> index;
+};
@@ -35,6 +35,7 @@
 #include <list>
 #include <vector>
 #include <limits>
+#include <cmath>
 
 #if (defined(_WIN32) || defined(__WIN32__) || defined(__TOS_WIN__) || defined(__WINDOWS__) || (defined(__APPLE__) & defined(__MACH__)))
 #include <cv.h>
@@ -257,6 +258,12 @@ struct CvBlob
     CvContourChainCode contour;           ///< Contour.
     CvContoursChainCode internalContours; ///< Internal contours.
 
+    unsigned int depthCount;  ///< Pixels with known (non-zero) depth, 0 if cvLabel had no depth image.
+    unsigned short depthMin;  ///< Minimum depth.
+    unsigned short depthMax;  ///< Maximum depth.
+    double depthSum;          ///< Sum of depths.
+    double depthSumSq;        ///< Sum of squared depths.
+
     bool completed;
 };
 
@@ -273,14 +280,16 @@ typedef std::map<CvLabel,CvBlob *> CvBlobs;
 /// \see CvBlob
 typedef std::pair<CvLabel,CvBlob *> CvLabelBlob;
 
-/// \fn unsigned int cvLabel (IplImage const *img, IplImage *imgOut, CvBlobs &blobs);
+/// \fn unsigned int cvLabel (IplImage const *img, IplImage *imgOut, CvBlobs &blobs, IplImage const *depth=NULL);
 /// \brief Label the connected parts of a binary image.
 /// Algorithm based on paper "A linear-time component-labeling algorithm using contour tracing technique" of Fu Chang, Chun-Jen Chen and Chi-Jen Lu.
 /// \param img Input binary image (depth=IPL_DEPTH_8U and num. channels=1).
 /// \param imgOut Output image (depth=IPL_DEPTH_LABEL and num. channels=1).
 /// \param blobs List of blobs.
+/// \param depth Optional depth image (depth=IPL_DEPTH_16U, num. channels=1, same size as img). The depth statistics of each blob are accumulated while labelling.
 /// \return Number of pixels that has been labeled.
-unsigned int cvLabel (IplImage const *img, IplImage *imgOut, CvBlobs &blobs);
+/// \see cvBlobDepthMean
+unsigned int cvLabel (IplImage const *img, IplImage *imgOut, CvBlobs &blobs, IplImage const *depth=NULL);
 
 //IplImage *cvFilterLabel(IplImage *imgIn, CvLabel label);
 
@@ -321,6 +330,30 @@ inline void cvReleaseBlob(CvBlob *blob)
     }
 }
 
+/// \fn inline double cvBlobDepthMean(CvBlob const *blob)
+/// \brief Mean of the known depths of a blob.
+/// \param blob Blob labelled with a depth image.
+/// \return Mean depth, 0 if the blob has no depth.
+/// \see cvLabel
+inline double cvBlobDepthMean(CvBlob const *blob)
+{
+    return blob->depthCount ? blob->depthSum/blob->depthCount : 0.;
+}
+
+/// \fn inline double cvBlobDepthStdDev(CvBlob const *blob)
+/// \brief Standard deviation of the known depths of a blob.
+/// \param blob Blob labelled with a depth image.
+/// \return Standard deviation, 0 if the blob has no depth.
+/// \see cvLabel
+inline double cvBlobDepthStdDev(CvBlob const *blob)
+{
+    if (!blob->depthCount)
+        return 0.;
+    double mean = blob->depthSum/blob->depthCount;
+    double var = blob->depthSumSq/blob->depthCount - mean*mean;
+    return var>0. ? sqrt(var) : 0.;
+}
+
 /// \fn inline void cvReleaseBlobs(CvBlobs &blobs)
 /// \brief Clear blobs structure.
 /// \param blobs List of blobs.
@@ -44,13 +44,33 @@ const int movesI[4][3][4] = { { { 1, -1, 3, CV_CHAINCODE_UP_RIGHT   }, { 0, -1,
                             };
 
 
-unsigned int cvLabel (IplImage const *img, IplImage *imgOut, CvBlobs &blobs)
+// Zero (unknown) depths are not counted.
+static inline void cvAddBlobDepth(CvBlob *blob, unsigned short d)
+{
+    if (!d)
+        return;
+
+    if (!blob->depthCount)
+    {
+        blob->depthMin = d;
+        blob->depthMax = d;
+    }
+    else if (d<blob->depthMin) blob->depthMin = d;
+    else if (d>blob->depthMax) blob->depthMax = d;
+
+    blob->depthCount++;
+    blob->depthSum += d;
+    blob->depthSumSq += (double)d*d;
+}
+
+unsigned int cvLabel (IplImage const *img, IplImage *imgOut, CvBlobs &blobs, IplImage const *depth)
 {
     CV_FUNCNAME("cvLabel");
     __CV_BEGIN__;
     {
         CV_ASSERT(img&&(img->depth==IPL_DEPTH_8U)&&(img->nChannels==1));
         CV_ASSERT(imgOut&&(imgOut->depth==IPL_DEPTH_LABEL)&&(imgOut->nChannels==1));
+        CV_ASSERT((!depth)||((depth->depth==IPL_DEPTH_16U)&&(depth->nChannels==1)));
 
         unsigned int numPixels=0;
 
@@ -83,8 +103,25 @@ unsigned int cvLabel (IplImage const *img, IplImage *imgOut, CvBlobs &blobs)
         unsigned char *imgDataIn = (unsigned char *)img->imageData + imgIn_offset;
         CvLabel *imgDataOut = (CvLabel *)imgOut->imageData + imgOut_offset;
 
+        unsigned short *imgDataDepth = NULL;
+        unsigned int stepDepth = 0;
+        if(depth)
+        {
+            stepDepth = depth->widthStep / (depth->depth / 8);
+            unsigned int depth_offset = 0;
+            if(depth->roi)
+            {
+                CV_ASSERT((depth->roi->width==imgIn_width)&&(depth->roi->height==imgIn_height));
+                depth_offset = depth->roi->xOffset + (depth->roi->yOffset * stepDepth);
+            }
+            else
+                CV_ASSERT((depth->width==imgIn_width)&&(depth->height==imgIn_height));
+            imgDataDepth = (unsigned short *)depth->imageData + depth_offset;
+        }
+
 #define imageIn(X, Y) imgDataIn[(X) + (Y)*stepIn]
 #define imageOut(X, Y) imgDataOut[(X) + (Y)*stepOut]
+#define addDepth(B, X, Y) if (imgDataDepth) cvAddBlobDepth((B), imgDataDepth[(X) + (Y)*stepDepth])
 
         CvLabel lastLabel = 0;
         CvBlob *lastBlob = NULL;
@@ -121,6 +158,10 @@ unsigned int cvLabel (IplImage const *img, IplImage *imgOut, CvBlobs &blobs)
                         blob->m10=x; blob->m01=y;
                         blob->m11=x*y;
                         blob->m20=x*x; blob->m02=y*y;
+                        blob->depthCount = 0;
+                        blob->depthMin = blob->depthMax = 0;
+                        blob->depthSum = blob->depthSumSq = 0.;
+                        addDepth(blob, x, y);
                         blob->internalContours.clear();
                         blobs.insert(CvLabelBlob(label,blob));
 
@@ -185,6 +226,7 @@ unsigned int cvLabel (IplImage const *img, IplImage *imgOut, CvBlobs &blobs)
                                         blob->m10+=xx; blob->m01+=yy;
                                         blob->m11+=xx*yy;
                                         blob->m20+=xx*xx; blob->m02+=yy*yy;
+                                        addDepth(blob, xx, yy);
                                     }
 
                                     break;
@@ -231,6 +273,7 @@ unsigned int cvLabel (IplImage const *img, IplImage *imgOut, CvBlobs &blobs)
                             blob->m10+=x; blob->m01+=y;
                             blob->m11+=x*y;
                             blob->m20+=x*x; blob->m02+=y*y;
+                            addDepth(blob, x, y);
                         }
                         else
                         {
@@ -297,6 +340,7 @@ unsigned int cvLabel (IplImage const *img, IplImage *imgOut, CvBlobs &blobs)
                                         blob->m10+=xx; blob->m01+=yy;
                                         blob->m11+=xx*yy;
                                         blob->m20+=xx*xx; blob->m02+=yy*yy;
+                                        addDepth(blob, xx, yy);
                                     }
 
                                     break;
@@ -330,6 +374,7 @@ unsigned int cvLabel (IplImage const *img, IplImage *imgOut, CvBlobs &blobs)
                         blob->m10+=x; blob->m01+=y;
                         blob->m11+=x*y;
                         blob->m20+=x*x; blob->m02+=y*y;
+                        addDepth(blob, x, y);
                     }
                 }
             }
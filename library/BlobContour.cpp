@@ -1,7 +1,114 @@
 #include "BlobContour.h"
+#include <cfloat>
+#include <cmath>
+#include <cstring>
 
 using namespace cv;
 
+/**************************************************************************
+		Chain code storage
+**************************************************************************/
+
+CChainCodePool& CChainCodePool::Instance()
+{
+	static CChainCodePool pool;
+	return pool;
+}
+
+CChainCodePool::CChainCodePool()
+{
+	m_mutex = (pthread_mutex_t)PTHREAD_MUTEX_INITIALIZER;
+	m_freeBuffers.reserve(MAX_FREE_BUFFERS);
+}
+
+CChainCodePool::~CChainCodePool()
+{
+	pthread_mutex_destroy(&m_mutex);
+}
+
+void CChainCodePool::Acquire(std::vector<t_chainCodeWord> &buffer, size_t nWords)
+{
+	pthread_mutex_lock(&m_mutex);
+	if(!m_freeBuffers.empty()){
+		buffer.swap(m_freeBuffers.back());
+		m_freeBuffers.pop_back();
+	}
+	pthread_mutex_unlock(&m_mutex);
+	buffer.clear();
+	buffer.reserve(nWords);
+}
+
+void CChainCodePool::Release(std::vector<t_chainCodeWord> &buffer)
+{
+	if(buffer.capacity()==0)
+		return;
+	buffer.clear();
+	pthread_mutex_lock(&m_mutex);
+	if(m_freeBuffers.size() < MAX_FREE_BUFFERS){
+		m_freeBuffers.push_back(std::vector<t_chainCodeWord>());
+		m_freeBuffers.back().swap(buffer);
+	}
+	pthread_mutex_unlock(&m_mutex);
+	//Buffers beyond the pool limit are simply freed
+	std::vector<t_chainCodeWord>().swap(buffer);
+}
+
+CChainCodeList::CChainCodeList(): m_slot(0), m_size(0)
+{
+}
+
+CChainCodeList::CChainCodeList(const CChainCodeList &source): m_slot(0), m_size(0)
+{
+	*this = source;
+}
+
+CChainCodeList::~CChainCodeList()
+{
+	CChainCodePool::Instance().Release(m_words);
+}
+
+CChainCodeList& CChainCodeList::operator=(const CChainCodeList &source)
+{
+	if(this != &source){
+		if(m_words.capacity() < source.m_words.size()){
+			CChainCodePool::Instance().Release(m_words);
+			CChainCodePool::Instance().Acquire(m_words, source.m_words.size());
+		}
+		m_words.assign(source.m_words.begin(), source.m_words.end());
+		m_slot = source.m_slot;
+		m_size = source.m_size;
+	}
+	return *this;
+}
+
+void CChainCodeList::reserve(size_t nCodes)
+{
+	size_t nWords = (nCodes + CHAINCODES_PER_WORD - 1) / CHAINCODES_PER_WORD;
+	if(nWords <= m_words.capacity())
+		return;
+	if(m_words.capacity() == 0){
+		CChainCodePool::Instance().Acquire(m_words, nWords);
+	}
+	else{
+		m_words.reserve(nWords);
+	}
+}
+
+void CChainCodeList::clear()
+{
+	CChainCodePool::Instance().Release(m_words);
+	m_slot = 0;
+	m_size = 0;
+}
+
+void CChainCodeList::Grow()
+{
+	if(m_words.capacity() == 0)
+		CChainCodePool::Instance().Acquire(m_words, 16);
+	else
+		m_words.reserve(m_words.capacity()*2);
+}
+
 CBlobContour::CBlobContour()
 {
 	m_startPoint.x = 0;
@@ -121,7 +228,19 @@ double CBlobContour::GetPerimeter()
 	if( IsEmpty() )
 		return 0;
 
-	m_perimeter = arcLength(GetContourPoints(),true);
+	//Same result as arcLength(GetContourPoints(),true), walking the chain codes
+	CChainCodePointIterator it = PointsBegin(), en = PointsEnd();
+	CvPoint first = *it, prev = first;
+	double perimeter = 0;
+	for(++it;it!=en;++it){
+		int dx = it->x - prev.x, dy = it->y - prev.y;
+		perimeter += std::sqrt((double)(dx*dx + dy*dy));
+		prev = *it;
+	}
+	int dx = first.x - prev.x, dy = first.y - prev.y;
+	perimeter += std::sqrt((double)(dx*dx + dy*dy));
+
+	m_perimeter = perimeter;
 	return m_perimeter;
 }
 
@@ -149,7 +268,16 @@ double CBlobContour::GetArea()
 
 	if( IsEmpty() )
 		return 0;
-	m_area = fabs(contourArea(GetContourPoints(),false));
+	//Shoelace formula on the chain code points, same as contourArea(GetContourPoints())
+	CChainCodePointIterator it = PointsBegin(), en = PointsEnd();
+	CvPoint first = *it, prev = first;
+	double a00 = 0;
+	for(++it;it!=en;++it){
+		a00 += (double)prev.x * it->y - (double)prev.y * it->x;
+		prev = *it;
+	}
+	a00 += (double)prev.x * first.y - (double)prev.y * first.x;
+	m_area = fabs(a00*0.5);
 	
 	return m_area;
 }
@@ -170,13 +298,101 @@ double CBlobContour::GetMoment(int p, int q)
 	if( m_moments.m00 == -1)
 	{
 		//cvMoments( GetContourPoints(), &m_moments );
-		m_moments = moments(GetContourPoints(),true);
+		//m_moments = moments(GetContourPoints(),true);
+		ComputeMoments();
 	}
 		
 	return cvGetSpatialMoment( &m_moments, p, q );
 
 }
 
+/**
+- FUNCTION: ComputeMoments
+- FUNCTIONALITY: Spatial moments up to order 3 of the polygon described by the chain codes,
+	computed with Green's theorem while walking the codes (same formulas as cv::moments on
+	the contour points, without materializing them)
+*/
+void CBlobContour::ComputeMoments()
+{
+	double a00 = 0, a10 = 0, a01 = 0, a20 = 0, a11 = 0, a02 = 0, a30 = 0, a21 = 0, a12 = 0, a03 = 0;
+	double xi, yi, xi2, yi2, xi_1, yi_1, xi_12, yi_12, dxy, xii_1, yii_1;
+
+	memset(&m_moments, 0, sizeof(m_moments));
+
+	CChainCodePointIterator it = PointsBegin(), en = PointsEnd();
+	CvPoint first = *it;
+	xi_1 = first.x; yi_1 = first.y;
+	xi_12 = xi_1 * xi_1;
+	yi_12 = yi_1 * yi_1;
+
+	//The closing edge (last point -> first point) is handled by the last iteration
+	bool closing = false;
+	for(++it;;){
+		if(it != en){
+			xi = it->x; yi = it->y;
+		}
+		else{
+			xi = first.x; yi = first.y;
+			closing = true;
+		}
+		xi2 = xi * xi;
+		yi2 = yi * yi;
+		dxy = xi_1 * yi - xi * yi_1;
+		xii_1 = xi_1 + xi;
+		yii_1 = yi_1 + yi;
+
+		a00 += dxy;
+		a10 += dxy * xii_1;
+		a01 += dxy * yii_1;
+		a20 += dxy * (xi_1 * xii_1 + xi2);
+		a11 += dxy * (xi_1 * (yii_1 + yi_1) + xi * (yii_1 + yi));
+		a02 += dxy * (yi_1 * yii_1 + yi2);
+		a30 += dxy * xii_1 * (xi_12 + xi2);
+		a03 += dxy * yii_1 * (yi_12 + yi2);
+		a21 += dxy * (xi_12 * (3 * yi_1 + yi) + 2 * xi * xi_1 * yii_1 + xi2 * (yi_1 + 3 * yi));
+		a12 += dxy * (yi_12 * (3 * xi_1 + xi) + 2 * yi * yi_1 * xii_1 + yi2 * (xi_1 + 3 * xi));
+
+		if(closing)
+			break;
+		xi_1 = xi; yi_1 = yi;
+		xi_12 = xi2; yi_12 = yi2;
+		++it;
+	}
+
+	if( fabs(a00) > FLT_EPSILON )
+	{
+		double sign = a00 > 0 ? 1.0 : -1.0;
+		m_moments.m00 = a00 * sign / 2;
+		m_moments.m10 = a10 * sign / 6;
+		m_moments.m01 = a01 * sign / 6;
+		m_moments.m20 = a20 * sign / 12;
+		m_moments.m11 = a11 * sign / 24;
+		m_moments.m02 = a02 * sign / 12;
+		m_moments.m30 = a30 * sign / 20;
+		m_moments.m21 = a21 * sign / 60;
+		m_moments.m12 = a12 * sign / 60;
+		m_moments.m03 = a03 * sign / 20;
+	}
+}
+
+CChainCodePointIterator CBlobContour::PointsBegin() const
+{
+	if(m_contour.size()==0){
+		t_chainCodeList::const_iterator none;
+		return CChainCodePointIterator(m_startPoint,none,none);
+	}
+	return CChainCodePointIterator(m_startPoint,m_contour[0].begin(),m_contour[0].end());
+}
+
+CChainCodePointIterator CBlobContour::PointsEnd() const
+{
+	if(m_contour.size()==0){
+		t_chainCodeList::const_iterator none;
+		return CChainCodePointIterator(m_startPoint,none,none,true);
+	}
+	return CChainCodePointIterator(m_startPoint,m_contour[0].end(),m_contour[0].end(),true);
+}
+
 const t_PointList CBlobContour::EMPTY_LIST = t_PointList();
 //! Calculate contour points from crack codes
 const t_PointList& CBlobContour::GetContourPoints()
@@ -186,19 +402,27 @@ const t_PointList& CBlobContour::GetContourPoints()
 	if(m_contourPoints.size()!=0)
 		return m_contourPoints[0];
 	m_contourPoints.push_back(t_PointList());
-	m_contourPoints[0].reserve(m_contour[0].size()+1);
-	m_contourPoints[0].push_back(m_startPoint);
-	t_chainCodeList::iterator it,en;
-	it = m_contour[0].begin();
-	en = m_contour[0].end();
-	Point pt = m_contourPoints[0][m_contourPoints.size()-1];
-	for(it;it!=en;it++){
-		pt = chainCode2Point(pt,*it);
-		m_contourPoints[0].push_back(pt);
-	}
+	CopyContourPoints(m_contourPoints[0]);
 	return m_contourPoints[0];
 }
 
+void CBlobContour::CopyContourPoints(t_PointList &points) const
+{
+	points.clear();
+	if(m_contour.size()==0)
+		return;
+	points.reserve(m_contour[0].size()+1);
+	CChainCodePointIterator it = PointsBegin(), en = PointsEnd();
+	for(;it!=en;++it){
+		points.push_back(*it);
+	}
+}
+
+void CBlobContour::ReleaseContourPoints()
+{
+	t_contours().swap(m_contourPoints);
+}
+
 
 t_contours& CBlobContour::GetContours()
 {
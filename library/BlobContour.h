@@ -7,19 +7,185 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/core.hpp>
 #include <list>
+#include <vector>
+#include <pthread.h>
 
 
 class CBlob; //Forward declaration in order to enable the "parent" field
 
 //! Type of chain codes
 typedef unsigned char t_chainCode;
-//! Type of list of chain codes
-typedef std::vector<t_chainCode> t_chainCodeList;
-typedef std::vector<t_chainCodeList> t_chainCodeContours;	//In order to emulate CvSeq objects and to comply with opencv 2.0 interface
 //! Type of list of points
 typedef std::vector<cv::Point> t_PointList;
 typedef std::vector<t_PointList> t_contours;
 
+//! Packed storage word for chain codes: 10 Freeman codes of 3 bits each per word
+typedef unsigned int t_chainCodeWord;
+#define CHAINCODE_BITS			3
+#define CHAINCODE_MASK			0x7
+#define CHAINCODES_PER_WORD		10
+
+//! Pool of word buffers shared by all the chain code lists, so that labelling
+//! a new frame reuses the buffers released by the blobs of the previous one.
+class CChainCodePool
+{
+public:
+	static CChainCodePool& Instance();
+
+	//! Returns an empty buffer with at least nWords of capacity
+	void Acquire(std::vector<t_chainCodeWord> &buffer, size_t nWords);
+	//! Gives the buffer capacity back to the pool. buffer is left empty.
+	void Release(std::vector<t_chainCodeWord> &buffer);
+
+private:
+	CChainCodePool();
+	~CChainCodePool();
+	CChainCodePool(const CChainCodePool&);
+	CChainCodePool& operator=(const CChainCodePool&);
+
+	//! Max number of idle buffers kept by the pool
+	static const size_t MAX_FREE_BUFFERS = 1024;
+
+	std::vector< std::vector<t_chainCodeWord> > m_freeBuffers;
+	pthread_mutex_t m_mutex;
+};
+
+//! List of chain codes, packed 3 bits per code in a pooled word buffer.
+class CChainCodeList
+{
+public:
+	//! Forward iterator over the codes of the list
+	class const_iterator
+	{
+	public:
+		const_iterator(): m_word(NULL), m_slot(0) {}
+		const_iterator(const t_chainCodeWord *word, int slot): m_word(word), m_slot(slot) {}
+
+		t_chainCode operator*() const
+		{
+			return (t_chainCode)((*m_word >> (m_slot*CHAINCODE_BITS)) & CHAINCODE_MASK);
+		}
+		const_iterator& operator++()
+		{
+			if(++m_slot == CHAINCODES_PER_WORD){
+				m_slot = 0;
+				m_word++;
+			}
+			return *this;
+		}
+		const_iterator operator++(int)
+		{
+			const_iterator tmp = *this;
+			++(*this);
+			return tmp;
+		}
+		bool operator==(const const_iterator &other) const
+		{
+			return m_word == other.m_word && m_slot == other.m_slot;
+		}
+		bool operator!=(const const_iterator &other) const
+		{
+			return !(*this == other);
+		}
+	private:
+		const t_chainCodeWord *m_word;
+		int m_slot;
+	};
+
+	CChainCodeList();
+	CChainCodeList(const CChainCodeList &source);
+	~CChainCodeList();
+	CChainCodeList& operator=(const CChainCodeList &source);
+
+	void push_back(t_chainCode code)
+	{
+		if(m_slot == CHAINCODES_PER_WORD || m_words.empty()){
+			if(m_words.size() == m_words.capacity())
+				Grow();
+			m_words.push_back(0);
+			m_slot = 0;
+		}
+		m_words.back() |= (t_chainCodeWord)(code & CHAINCODE_MASK) << (m_slot*CHAINCODE_BITS);
+		m_slot++;
+		m_size++;
+	}
+	//! Reserves space for nCodes codes (taken from the pool)
+	void reserve(size_t nCodes);
+	//! Removes all the codes and gives the buffer back to the pool
+	void clear();
+
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+
+	const_iterator begin() const
+	{
+		return const_iterator(m_words.empty() ? NULL : &m_words[0], 0);
+	}
+	const_iterator end() const
+	{
+		if(m_words.empty())
+			return const_iterator(NULL, 0);
+		//The end of a full last word is the first slot of the next one
+		if(m_slot == CHAINCODES_PER_WORD)
+			return const_iterator(&m_words[0] + m_words.size(), 0);
+		return const_iterator(&m_words[0] + m_words.size() - 1, m_slot);
+	}
+
+	//! Memory used by the codes, in bytes
+	size_t memoryUsage() const { return m_words.capacity()*sizeof(t_chainCodeWord); }
+
+private:
+	void Grow();
+
+	std::vector<t_chainCodeWord> m_words;
+	//! Number of codes used in the last word
+	int m_slot;
+	size_t m_size;
+};
+
+//! Type of list of chain codes
+typedef CChainCodeList t_chainCodeList;
+typedef std::vector<t_chainCodeList> t_chainCodeContours;	//In order to emulate CvSeq objects and to comply with opencv 2.0 interface
+
+CvPoint chainCode2Point(CvPoint origin,t_chainCode code);
+
+//! Forward iterator yielding the contour points of a chain code list on the fly,
+//! starting from the contour start point, without materializing them.
+//! A list of n codes yields n+1 points, as GetContourPoints does.
+class CChainCodePointIterator
+{
+public:
+	CChainCodePointIterator(CvPoint startPoint, t_chainCodeList::const_iterator code,
+							t_chainCodeList::const_iterator codeEnd, bool past = false):
+		m_point(startPoint), m_code(code), m_codeEnd(codeEnd), m_past(past) {}
+
+	const CvPoint& operator*() const { return m_point; }
+	const CvPoint* operator->() const { return &m_point; }
+
+	CChainCodePointIterator& operator++()
+	{
+		if(m_code == m_codeEnd){
+			m_past = true;
+		}
+		else{
+			m_point = chainCode2Point(m_point, *m_code);
+			++m_code;
+		}
+		return *this;
+	}
+	bool operator==(const CChainCodePointIterator &other) const
+	{
+		return m_code == other.m_code && m_past == other.m_past;
+	}
+	bool operator!=(const CChainCodePointIterator &other) const { return !(*this == other); }
+
+private:
+	CvPoint m_point;
+	t_chainCodeList::const_iterator m_code;
+	t_chainCodeList::const_iterator m_codeEnd;
+	bool m_past;
+};
+
 
 //! Max order of calculated moments
 #define MAX_MOMENTS_ORDER		3
@@ -58,8 +224,17 @@ public:
 		return m_contour.size() == 0;
 	}
 
-	//! Returns first contour
+	//! Iterates the points of the first contour without materializing them
+	CChainCodePointIterator PointsBegin() const;
+	CChainCodePointIterator PointsEnd() const;
+
+	//! Returns first contour. The points are materialized and cached on the first call,
+	//! use PointsBegin()/PointsEnd() or CopyContourPoints() to avoid the cache.
 	const t_PointList& GetContourPoints();
+	//! Materializes the points of the first contour into points, without caching them
+	void CopyContourPoints(t_PointList &points) const;
+	//! Drops the cached contour points, if any
+	void ReleaseContourPoints();
 	//! Returns all contours (compatible with drawContours structure)
 	t_contours& GetContours();
 
@@ -82,6 +257,8 @@ protected:
 	double GetPerimeter();
 	//! Get contour moment (p,q up to MAX_CALCULATED_MOMENTS)
 	double GetMoment(int p, int q);
+	//! Computes m_moments from the chain codes
+	void ComputeMoments();
 
 	//! Crack code list
 	t_chainCodeContours m_contour;
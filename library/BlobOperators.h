@@ -231,6 +231,66 @@ private:
 
 };
 
+//! Class to get the mean of the known depths of a blob
+//! (only for blobs labelled with a depth image, 0 otherwise)
+class CBlobGetDepthMean: public COperadorBlob
+{
+public:
+    double operator()(CBlob &blob)
+	{
+		return blob.DepthMean();
+	}
+	const char *GetNom()
+	{
+		return "CBlobGetDepthMean";
+	}
+};
+
+//! Class to get the standard deviation of the known depths of a blob
+//! (only for blobs labelled with a depth image, 0 otherwise)
+class CBlobGetDepthStdDev: public COperadorBlob
+{
+public:
+    double operator()(CBlob &blob)
+	{
+		return blob.DepthStdDev();
+	}
+	const char *GetNom()
+	{
+		return "CBlobGetDepthStdDev";
+	}
+};
+
+//! Class to get the minimum of the known depths of a blob
+//! (only for blobs labelled with a depth image, 0 otherwise)
+class CBlobGetDepthMin: public COperadorBlob
+{
+public:
+    double operator()(CBlob &blob)
+	{
+		return blob.DepthMin();
+	}
+	const char *GetNom()
+	{
+		return "CBlobGetDepthMin";
+	}
+};
+
+//! Class to get the maximum of the known depths of a blob
+//! (only for blobs labelled with a depth image, 0 otherwise)
+class CBlobGetDepthMax: public COperadorBlob
+{
+public:
+    double operator()(CBlob &blob)
+	{
+		return blob.DepthMax();
+	}
+	const char *GetNom()
+	{
+		return "CBlobGetDepthMax";
+	}
+};
+
 //! Classe per calcular la compacitat d'un blob
 //! Class to calculate the compactness of a blob
 class CBlobGetCompactness: public COperadorBlob
@@ -104,6 +104,11 @@ CBlobResult::CBlobResult(IplImage *source, IplImage *mask,int numThreads)
 	- mask: optional mask to apply. The blobs will be extracted where the mask is
 			not 0. All the neighbouring blobs where the mask is 0 will be extern blobs
 	- numThreads: number of labelling threads. 
+	- activeTiles: optional map, one byte per tileSize x tileSize tile of source.
+			Tiles where it is 0 must be empty, the labeller does not scan them.
+	- depth: optional CV_16UC1 image of the size of source. The min, max, mean and
+			std. dev. of the non-zero depths of each blob are gathered while labelling
+			(CBlob::DepthMean etc.).
 - RESULT:
 	- object with all the blobs in the image.
 - RESTRICTIONS:
@@ -111,7 +116,9 @@ CBlobResult::CBlobResult(IplImage *source, IplImage *mask,int numThreads)
 - CREATION DATE: 06-04-2013.
 - MODIFICATION: Date. Author. Description.
 */
-CBlobResult::CBlobResult(Mat &source, const Mat &mask,int numThreads){
+CBlobResult::CBlobResult(Mat &source, const Mat &mask,int numThreads,const Mat &activeTiles,int tileSize,const Mat &depth){
+	compLabeler.setActiveTiles(activeTiles,tileSize);
+	compLabeler.setDepthImage(depth);
 	if(mask.data){
 		Mat temp=Mat::zeros(source.size(),source.type());
 		source.copyTo(temp,mask);
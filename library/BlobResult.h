@@ -93,7 +93,9 @@ public:
 	//Constructor, opencv 1.0 and 2.0 interfaces.
 	CBlobResult();
 	CBlobResult(IplImage *source, IplImage *mask = NULL, int numThreads=1);
-	CBlobResult(cv::Mat &source, const cv::Mat &mask = cv::Mat(),int numThreads=1);
+	CBlobResult(cv::Mat &source, const cv::Mat &mask = cv::Mat(),int numThreads=1,
+				const cv::Mat &activeTiles = cv::Mat(), int tileSize = 0,
+				const cv::Mat &depth = cv::Mat());
 	CBlobResult( const CBlobResult &source );
 	//! Destructor
 	virtual ~CBlobResult();
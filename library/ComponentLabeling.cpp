@@ -1,7 +1,41 @@
 #include "ComponentLabeling.h"
+#include <cstring>
+#include <stdint.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 using namespace cv;
 
+//Number of leading zero bytes in p[0..n), 16 bytes at a time while possible
+static inline int zeroRun(const uchar* p, int n)
+{
+	int k=0;
+	for(;k+16<=n;k+=16){
+#if defined(__SSE2__)
+		__m128i v = _mm_loadu_si128((const __m128i*)(p+k));
+		if(_mm_movemask_epi8(_mm_cmpeq_epi8(v,_mm_setzero_si128()))!=0xFFFF)
+			break;
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+		uint8x16_t v = vld1q_u8(p+k);
+		uint8x8_t o = vorr_u8(vget_low_u8(v),vget_high_u8(v));
+		if(vget_lane_u64(vreinterpret_u64_u8(o),0))
+			break;
+#else
+		uint64_t a,b;
+		memcpy(&a,p+k,8);
+		memcpy(&b,p+k+8,8);
+		if(a|b)
+			break;
+#endif
+	}
+	while(k<n && !p[k])
+		k++;
+	return k;
+}
+
 myCompLabeler::myCompLabeler(Mat &binImage,CBlobContour** lab,Point start,Point end):
 	startPoint(start),endPoint(end),
 	binaryImage(binImage)
@@ -10,6 +44,70 @@ myCompLabeler::myCompLabeler(Mat &binImage,CBlobContour** lab,Point start,Point
 	labels = lab;
 	r=0;c=0;
 	dir=0;
+	tiles=NULL;
+	tileStep=0;tileSize=0;
+	ptrDataDepth=NULL;
+	depthBlob=NULL;
+	depthCount=0;
+}
+
+void myCompLabeler::SetActiveTiles( const uchar* tileMap,int step,int size )
+{
+	tiles=tileMap;
+	tileStep=step;
+	tileSize=size;
+}
+
+void myCompLabeler::SetDepthImage( const ushort* depth )
+{
+	ptrDataDepth=depth;
+}
+
+//Adds the depth at pos to the run of currentBlob
+inline void myCompLabeler::AddDepth()
+{
+	if(currentBlob!=depthBlob){
+		FlushDepth();
+		depthBlob=currentBlob;
+	}
+	ushort d = ptrDataDepth[pos];
+	if(!d)
+		return;
+	if(depthCount==0){
+		depthMin=depthMax=d;
+		depthSum=depthSumSq=0;
+	}
+	else if(d<depthMin)
+		depthMin=d;
+	else if(d>depthMax)
+		depthMax=d;
+	depthCount++;
+	depthSum+=d;
+	depthSumSq+=(double)d*d;
+}
+
+void myCompLabeler::FlushDepth()
+{
+	if(depthBlob && depthCount){
+		//Blobs crossing the border between two labellers are updated by both threads,
+		//so a group's labellers keep their runs and the group merges them after the join
+		if(parent){
+			DepthRun run = { depthBlob, depthCount, depthMin, depthMax, depthSum, depthSumSq };
+			depthRuns.push_back(run);
+		}
+		else
+			depthBlob->AddDepthStats(depthCount,depthMin,depthMax,depthSum,depthSumSq);
+	}
+	depthCount=0;
+}
+
+void myCompLabeler::MergeDepth()
+{
+	for(size_t i=0;i<depthRuns.size();i++){
+		const DepthRun &run = depthRuns[i];
+		run.blob->AddDepthStats(run.count,run.min,run.max,run.sum,run.sumSq);
+	}
+	depthRuns.clear();
 }
 
 myCompLabeler::~myCompLabeler()
@@ -27,11 +125,25 @@ void myCompLabeler::Label()
 	ptrDataBinary = binaryImage.data;
 	ptrDataLabels = labels;
 	currentBlob=NULL;
+	depthBlob=NULL;
+	depthCount=0;
+	depthRuns.clear();
 
 	h = binaryImage.size().height;
 	w = binaryImage.size().width;
 	CBlobContour* label=NULL;
+	const uchar* tileRow=NULL;
+	int nTileCols = tiles ? (w+tileSize-1)/tileSize : 0;
 	for(r=startPoint.y;r<endPoint.y;r++){
+		if(tiles){
+			//Whole row of empty tiles, nothing to label
+			tileRow = tiles+(r/tileSize)*tileStep;
+			int t=0;
+			while(t<nTileCols && !tileRow[t])
+				t++;
+			if(t==nTileCols)
+				continue;
+		}
 		//First col
 		pos = r*w;
 		c=startPoint.x;
@@ -46,13 +158,24 @@ void myCompLabeler::Label()
 				blobs.push_back(currentBlob);
 				TracerExt();
 			}
+			if(ptrDataDepth)
+				AddDepth();
 			if(!ptrDataBinary[pos+1] && !ptrDataLabels[pos+1]){
 				TracerInt();
 			}
         }
 		//Other cols
 		for(c=startPoint.x+1;c<endPoint.x-1;c++){
+			if(tileRow && !tileRow[c/tileSize]){
+				c = std::min((c/tileSize+1)*tileSize,endPoint.x-1)-1;
+				continue;
+			}
 			pos = r*w+c;
+			if(!ptrDataBinary[pos]){
+				//Zero pixels neither start nor close a contour, jump to the next non-zero one
+				c += zeroRun(ptrDataBinary+pos,endPoint.x-1-c)-1;
+				continue;
+			}
             if(ptrDataBinary[pos]){
                 label = ptrDataLabels[pos];
                 if(label!=0)
@@ -62,6 +185,8 @@ void myCompLabeler::Label()
                     blobs.push_back(currentBlob);
                     TracerExt();
                 }
+                if(ptrDataDepth)
+                    AddDepth();
                 if(!ptrDataBinary[pos+1] && ptrDataLabels[pos+1]==0){
                     TracerInt();
                 }
@@ -78,8 +203,12 @@ void myCompLabeler::Label()
 				blobs.push_back(currentBlob);
 				TracerExt();
 			}
+			if(ptrDataDepth)
+				AddDepth();
 		}
 	}
+	if(ptrDataDepth)
+		FlushDepth();
 }
 
 void* myCompLabeler::thread_Labeling( void* o )
@@ -393,15 +522,46 @@ int myCompLabeler::freemanC[8] = {1,1,0,-1,-1,-1,0,1};
 
 int myCompLabeler::freemanR[8] = {0,-1,-1,-1,0,1,1,1};
 
+void myCompLabelerGroup::setActiveTiles( const Mat &tiles, int size )
+{
+	activeTiles=tiles;
+	tileSize=size;
+}
+
+void myCompLabelerGroup::setDepthImage( const Mat &depthImage )
+{
+	if(!depthImage.data){
+		depth=Mat();
+		return;
+	}
+	CV_Assert(depthImage.type()==CV_16UC1);
+	if(depthImage.isContinuous())
+		depth=depthImage;
+	else
+		depth=depthImage.clone();
+}
+
 void myCompLabelerGroup::doLabeling(Blob_vector &blobs)
 {	
 	t_labelType label = 0;
+	const uchar* tileMap = (activeTiles.data && tileSize>0) ? activeTiles.data : NULL;
+	const ushort* depthMap = NULL;
+	if(depth.data){
+		CV_Assert(depth.size()==img.size());
+		depthMap = depth.ptr<ushort>();
+	}
+	for(int i=0;i<numThreads;i++){
+		labelers[i]->SetActiveTiles(tileMap,(int)activeTiles.step,tileSize);
+		labelers[i]->SetDepthImage(depthMap);
+	}
 	if(numThreads>1){
 		//Preliminary step in order to pre-compute all the blobs crossing the border
 		for(int i=1;i<numThreads;i++){
 			Point offset(img.size().width,1);
 			myCompLabeler lbl(img,labels,labelers[i]->startPoint,labelers[i]->startPoint+offset);
 			lbl.parent=this;
+			lbl.SetActiveTiles(tileMap,(int)activeTiles.step,tileSize);
+			//No depth here, the row is scanned again by its labeller
 			lbl.Label();
 			//cout << "Single pass\t" << lbl.blobs.size()<<endl;
 			for(unsigned int i=0;i<lbl.blobs.size();i++){
@@ -421,6 +581,7 @@ void myCompLabelerGroup::doLabeling(Blob_vector &blobs)
         labelers[0]->Label();
 	}
     for(int i=0;i<numThreads;i++){
+        labelers[i]->MergeDepth();
         //cout << "MT pass " <<i<<"\t" << labelers[i]->blobs.size()<<endl;
         for(unsigned int j=0;j<labelers[i]->blobs.size();j++){
             labelers[i]->blobs[j]->SetID(label);
@@ -436,6 +597,7 @@ myCompLabelerGroup::myCompLabelerGroup()
 	labels=NULL;
 	labelers=NULL;
 	tIds=NULL;
+	tileSize=0;
 }
 
 myCompLabelerGroup::~myCompLabelerGroup()
@@ -448,8 +610,7 @@ myCompLabelerGroup::~myCompLabelerGroup()
 	}
 	if(tIds)
 		delete [] tIds;
-	if(labels)
-		delete [] labels;
+	labels=NULL;
 }
 
 void myCompLabelerGroup::set( int nThreads, Mat binIm )
@@ -462,12 +623,11 @@ void myCompLabelerGroup::set( int nThreads, Mat binIm )
 		this->img=binIm.clone();
 	}
 	//this->labels = Mat_<int>::zeros(img.size());
-	if (labels){
-		delete [] labels;
-	}
 	int nPts = binIm.size().width*binIm.size().height;
-	labels = new CBlobContour*[nPts];
-	memset(labels,0,nPts*sizeof(CBlob*));
+	labelBuffer.allocator = bufferAllocator;
+	labelBuffer.create(1,nPts*(int)sizeof(CBlobContour*),CV_8UC1);
+	labels = (CBlobContour**)labelBuffer.data;
+	memset(labels,0,nPts*sizeof(CBlobContour*));
 
 	if(tIds)
 		delete []tIds;
@@ -499,14 +659,19 @@ void myCompLabelerGroup::set( int nThreads, Mat binIm )
 
 void myCompLabelerGroup::Reset()
 {
-	if(labels){
-		delete []labels;
-		labels=NULL;
-	}
+	labelBuffer.release();
+	labels=NULL;
 	for(int i=0;i<numThreads;i++)
 		labelers[i]->Reset();
 }
 
+cv::MatAllocator* myCompLabelerGroup::bufferAllocator = NULL;
+
+void myCompLabelerGroup::setBufferAllocator( cv::MatAllocator* allocator )
+{
+	bufferAllocator=allocator;
+}
+
 void myCompLabelerGroup::acquireMutex()
 {
 	pthread_mutex_lock(&mutexBlob);
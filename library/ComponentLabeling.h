@@ -35,6 +35,29 @@ private:
 
 	CBlob *currentBlob;
 	CBlobContour *currentContour;
+
+	//Optional active tile map (one byte per tile, 0 = tile is empty), NULL to scan everything
+	const uchar* tiles;
+	int tileStep,tileSize;
+
+	//Optional depth image (CV_16UC1, same size as the binary one), NULL to skip depth statistics.
+	//Depth is accumulated per run of pixels of the same blob. When the run ends it is merged into the blob,
+	//or, for a labeller of a group, kept in depthRuns and merged by the group after the threads are joined.
+	const ushort* ptrDataDepth;
+	CBlob *depthBlob;
+	int depthCount;
+	ushort depthMin,depthMax;
+	double depthSum,depthSumSq;
+	struct DepthRun{
+		CBlob *blob;
+		int count;
+		ushort min,max;
+		double sum,sumSq;
+	};
+	std::vector<DepthRun> depthRuns;
+	void AddDepth();
+	void FlushDepth();
+	void MergeDepth();
 public:
 	Blob_vector blobs;
 	cv::Mat binaryImage;
@@ -44,6 +67,8 @@ public:
 	~myCompLabeler();
 
 	void Label();		//Do labeling in region defined by startpoint and endpoint
+	void SetActiveTiles(const uchar* tileMap,int step,int size); //Rows/columns of empty tiles are not scanned
+	void SetDepthImage(const ushort* depth); //Per blob depth statistics, NULL to disable
 	void Reset(); //Resets internal buffers
 	void TracerExt();	//External contours tracer
 	void TracerInt(int startDir = 5);	//Internal contours tracer
@@ -61,6 +86,11 @@ private:
 	pthread_mutex_t mutexBlob;
 	//Mat_<int> labels;
 	CBlobContour** labels;
+	cv::Mat labelBuffer; //Storage of labels
+	static cv::MatAllocator* bufferAllocator;
+	cv::Mat activeTiles;
+	int tileSize;
+	cv::Mat depth;
 
 	void acquireMutex();
 	void releaseMutex();
@@ -71,6 +101,16 @@ public:
 	cv::Mat img;
 	void doLabeling(Blob_vector &blobs);
 	void set(int numThreads, cv::Mat img);
+	//Tiles of tileSize x tileSize pixels where activeTiles is 0 must be empty in img; they are skipped by the scan.
+	//Contours are still traced through them. An empty map scans the whole image.
+	void setActiveTiles(const cv::Mat &activeTiles, int tileSize);
+	//Optional CV_16UC1 depth image of the same size as img. The min, max, sum and sum of squares of the
+	//non-zero depths of each blob are accumulated in the labelling scan (CBlob::DepthMean etc.).
+	//An empty Mat disables it.
+	void setDepthImage(const cv::Mat &depth);
+	//Allocator of the per-image label buffer (e.g. a pool, so labelling every frame does not
+	//allocate). NULL restores OpenCV's default. Must outlive every labeller.
+	static void setBufferAllocator(cv::MatAllocator* allocator);
 	void Reset();
 
 friend class myCompLabeler;
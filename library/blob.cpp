@@ -32,6 +32,9 @@ CBlob::CBlob()
     isJoined=false;
     startPassed=false;
     _completed = false;
+    m_depthCount = 0;
+    m_depthMin = m_depthMax = 0;
+    m_depthSum = m_depthSumSq = 0;
 }
 CBlob::CBlob( t_labelType id, CvPoint startPoint, CvSize originalImageSize ):m_externalContour(startPoint,originalImageSize)
 {
@@ -47,6 +50,9 @@ CBlob::CBlob( t_labelType id, CvPoint startPoint, CvSize originalImageSize ):m_e
     isJoined=false;
     startPassed=false;
     _completed = false;
+    m_depthCount = 0;
+    m_depthMin = m_depthMax = 0;
+    m_depthSum = m_depthSumSq = 0;
 }
 //! Copy constructor
 CBlob::CBlob( const CBlob &src )
@@ -72,6 +78,11 @@ CBlob& CBlob::operator=(const CBlob &src )
         m_externPerimeter = src.m_externPerimeter;
         m_meanGray = src.m_meanGray;
         m_stdDevGray = src.m_stdDevGray;
+        m_depthCount = src.m_depthCount;
+        m_depthMin = src.m_depthMin;
+        m_depthMax = src.m_depthMax;
+        m_depthSum = src.m_depthSum;
+        m_depthSumSq = src.m_depthSumSq;
         m_boundingBox = src.m_boundingBox;
         m_ellipse = src.m_ellipse;
         m_originalImageSize = src.m_originalImageSize;
@@ -643,22 +654,23 @@ CvRect CBlob::GetBoundingBox()
         return m_boundingBox;
     }
 
-    t_PointList externContour;
-
-    // get contour pixels
-    externContour = m_externalContour.GetContourPoints();
-
     // it is an empty blob?
     m_boundingBox.x = 1000000;
     m_boundingBox.y = 1000000;
     m_boundingBox.width = 0;
     m_boundingBox.height = 0;
 
+    if( m_externalContour.IsEmpty() )
+    {
+        m_boundingBox.x = m_boundingBox.y = 0;
+        return m_boundingBox;
+    }
 
-    t_PointList::iterator it=externContour.begin(),en=externContour.end();
-    for( it;it!=en;it++)
+    // walk the contour pixels straight from the chain codes
+    CChainCodePointIterator it=m_externalContour.PointsBegin(),en=m_externalContour.PointsEnd();
+    for( ;it!=en;++it)
     {
-        Point &actualPoint = *it;
+        const CvPoint &actualPoint = *it;
 
         m_boundingBox.x = MIN( actualPoint.x, m_boundingBox.x );
         m_boundingBox.y = MIN( actualPoint.y, m_boundingBox.y );
@@ -964,6 +976,7 @@ void CBlob::JoinBlob( CBlob *blob)
     this->m_boundingBox.width=-1;
     this->m_externPerimeter=-1;
     this->m_meanGray=-1;
+    this->AddDepthStats(blob->m_depthCount,blob->m_depthMin,blob->m_depthMax,blob->m_depthSum,blob->m_depthSumSq);
 
 }
 
@@ -981,6 +994,32 @@ void CBlob::requestDeletion( CBlob *blob )
     blob->deleteRequestOwnerBlob=this;
 }
 
+void CBlob::AddDepthStats( int count, unsigned short minDepth, unsigned short maxDepth, double sum, double sumSq )
+{
+    if(count<=0)
+        return;
+    if(m_depthCount==0){
+        m_depthMin = minDepth;
+        m_depthMax = maxDepth;
+    }
+    else{
+        m_depthMin = std::min(m_depthMin,minDepth);
+        m_depthMax = std::max(m_depthMax,maxDepth);
+    }
+    m_depthCount += count;
+    m_depthSum += sum;
+    m_depthSumSq += sumSq;
+}
+
+double CBlob::DepthStdDev() const
+{
+    if(m_depthCount==0)
+        return 0;
+    double mean = m_depthSum / m_depthCount;
+    double var = m_depthSumSq / m_depthCount - mean*mean;
+    return var > 0 ? sqrt(var) : 0;
+}
+
 int CBlob::getNumJoinedBlobs()
 {
     return joinedBlobs.size();
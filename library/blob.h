@@ -185,6 +185,33 @@ public:
 	
 	int getNumJoinedBlobs(); // For joined blobs, return the number of sub-blobs.
 
+	//Depth statistics, gathered by the labeller in the labelling scan when it is given
+	//a CV_16UC1 depth image (see CBlobResult). Zero (unknown) depth pixels are not counted.
+	bool HasDepthStats() const
+	{
+		return m_depthCount > 0;
+	}
+	//! Number of pixels with known depth
+	int DepthCount() const
+	{
+		return m_depthCount;
+	}
+	double DepthMin() const
+	{
+		return m_depthCount ? m_depthMin : 0;
+	}
+	double DepthMax() const
+	{
+		return m_depthCount ? m_depthMax : 0;
+	}
+	double DepthMean() const
+	{
+		return m_depthCount ? m_depthSum / m_depthCount : 0;
+	}
+	double DepthStdDev() const;
+	//! Merges the statistics of count more depth pixels into the blob's
+	void AddDepthStats(int count, unsigned short minDepth, unsigned short maxDepth, double sum, double sumSq);
+
 private:
 	//Just for multithread joining routine;
 	bool startPassed;
@@ -223,6 +250,10 @@ private:
 	double m_meanGray;
 	//! Standard deviation from gray color blob distribution
 	double m_stdDevGray;
+	//! Depth statistics (see HasDepthStats)
+	int m_depthCount;
+	unsigned short m_depthMin, m_depthMax;
+	double m_depthSum, m_depthSumSq;
 	//! Bounding box
 	CvRect m_boundingBox;
 	//! Bounding ellipse
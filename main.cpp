@@ -4,6 +4,9 @@
 #include "opencv2/features2d/features2d.hpp"
 #include "opencv2/photo/photo.hpp"
 //#include "opencv2/optflow
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <unistd.h>
@@ -16,6 +19,7 @@
 #include "IExtracter.h"
 #include "AdaptableBlobsExtracter.h"
 #include "DepthBlobsExtracter.h"
+#include "DepthBlobsEnsemble.h"
 #include "BlobTracker.h"
 #include "BlobContour.h"
 #include "Fitting.h"
@@ -25,18 +29,20 @@
 #include "mser3.hpp"
 #include "BlobCouting.h"
 #include "BlobTracking.h"
+#include "StagePixels.h"
+#include "FrameScheduler.h"
+#include "FramePool.h"
+#include "ComponentLabeling.h"
+#include "HeightTransformer.h"
+#include "TemporalDepthFilter.h"
+#include "DetectionCache.h"
+#include "ParameterSweep.h"
 
 #include "persistence1d.hpp"
 
 static int fps_counter = 0;
 static clock_t fps_tm = 0;
 
-typedef struct IOArgSt {
-    cv::Mat iImage;
-    cv::Mat oImage;
-    IExtracter* extracter;
-} IOArgSt;
-
 void TruncValue(cv::Mat &img, short min_val, short max_val) {
     assert(max_val >= min_val);
     unsigned short* ptr = img.ptr<unsigned short>();
@@ -98,24 +104,116 @@ void threshold(const cv::Mat& src, cv::Mat& dst, const short min, const short ma
     }
 }
 
-void* threadFunc(void* arg) {
-    IOArgSt* st = static_cast<IOArgSt*>(arg);
+// Part of the camera frame that dst(procRoi) is resampled from when the capture
+// roi is resized to dstSize.
+cv::Rect captureRect(const cv::Rect& roi, const cv::Size& dstSize, const cv::Rect& procRoi) {
+    double sx = (double)roi.width / dstSize.width;
+    double sy = (double)roi.height / dstSize.height;
+    int x0 = cvFloor(procRoi.x * sx);
+    int y0 = cvFloor(procRoi.y * sy);
+    int x1 = cvCeil((procRoi.x + procRoi.width) * sx);
+    int y1 = cvCeil((procRoi.y + procRoi.height) * sy);
+    return cv::Rect(roi.x + x0, roi.y + y0, x1 - x0, y1 - y0) & roi;
+}
 
-    IExtracter* extracter = static_cast<IExtracter*>(st->extracter);
-    if (st && extracter) {
-        extracter->extracts(st->iImage, st->oImage);
+// Debug view of what the tracker is handed: the detections' masks painted from
+// their runs, with the current tracks drawn on top.
+void showDetections(const std::vector<Detection>& detections, const cvb::CvTracks& tracks,
+                    cv::Mat& mask, cv::Mat& drawer) {
+    mask.setTo(0);
+    for (size_t i = 0; i < detections.size(); ++i) {
+        const std::vector<cv::Vec3i>& runs = detections[i].runs;
+        for (size_t j = 0; j < runs.size(); ++j) {
+            uchar* row = mask.ptr<uchar>(runs[j][0]);
+            std::fill(row + runs[j][1], row + runs[j][2], (uchar)255);
+        }
     }
 
-    return NULL;
+    cv::cvtColor(mask, drawer, CV_GRAY2BGR);
+    IplImage img = drawer;
+    cvb::cvRenderTracks(tracks, &img, &img, CV_TRACK_RENDER_ID|CV_TRACK_RENDER_BOUNDING_BOX);
+    cv::imshow("detections", drawer);
+    cv::waitKey(1);
 }
 
-int main(int argc, char** argv) {
-    if(argc != 2)
-    {
-        std::cout << "./pelpleCounting filename ";
+// Replays a cache written with --record through a grid of tracker and counter
+// settings and prints each setting's counts, best one last.
+int runSweep(const char* cacheFile, int goldenIn, int goldenOut, const RectScale& rectScale) {
+    DetectionCache cache;
+    if (!cache.load(cacheFile)) {
+        printf("load %s failed\n", cacheFile);
         return -1;
     }
-    char* filePath = argv[1];
+
+    const float distances[] = { 20, 30, 40, 60 };
+    const uint inactives[] = { 5, 10, 20 };
+    const double thresholds[] = { 0, 5, 10 };
+
+    std::vector<SweepConfig> configs;
+    for (size_t d = 0; d < sizeof(distances)/sizeof(distances[0]); ++d) {
+        for (size_t i = 0; i < sizeof(inactives)/sizeof(inactives[0]); ++i) {
+            for (size_t t = 0; t < sizeof(thresholds)/sizeof(thresholds[0]); ++t) {
+                SweepConfig config;
+                config.maxMatchDistance = distances[d];
+                config.inactiveFrame = inactives[i];
+                config.activeFrame = 0;
+                config.rectScale = rectScale;
+                config.lineStatus = LINE_HORIZONTAL;
+                config.ioDirection = IO_DIRECTION_BOTTOM_TO_TOP;
+                config.distanceThreshold = thresholds[t];
+                configs.push_back(config);
+            }
+        }
+    }
+
+    ParameterSweep sweep(cache, goldenIn, goldenOut);
+    std::vector<SweepResult> results;
+    sweep.run(configs, results);
+
+    for (size_t i = 0; i < configs.size(); ++i) {
+        std::cout << "distance " << configs[i].maxMatchDistance
+                  << " inactive " << configs[i].inactiveFrame
+                  << " threshold " << configs[i].distanceThreshold
+                  << ": in " << results[i].iPeople << " out " << results[i].oPeople
+                  << " error " << results[i].error << std::endl;
+    }
+
+    int best = ParameterSweep::best(results);
+    if (best >= 0) {
+        std::cout << "best: distance " << configs[best].maxMatchDistance
+                  << " inactive " << configs[best].inactiveFrame
+                  << " threshold " << configs[best].distanceThreshold
+                  << " error " << results[best].error << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    // --mser: detect with AdaptableBlobsExtracter, scanning only the tracks'
+    // predicted regions between full scans, instead of the depth ensemble
+    // --record cache: write every frame's detections to cache (no frame is
+    // skipped, so the cache replays frame by frame) and stop once the file's
+    // frames are processed
+    // --sweep cache in out: tune the tracker and counter on a recorded cache
+    // against the true in/out counts, without reading any depth
+    bool useMser = false;
+    const char* recordFile = NULL;
+    const char* sweepFile = NULL;
+    int goldenIn = 0, goldenOut = 0;
+    char* filePath = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--mser") == 0) {
+            useMser = true;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordFile = argv[++i];
+        } else if (strcmp(argv[i], "--sweep") == 0 && i + 3 < argc) {
+            sweepFile = argv[++i];
+            goldenIn = atoi(argv[++i]);
+            goldenOut = atoi(argv[++i]);
+        } else {
+            filePath = argv[i];
+        }
+    }
 
     RectScale rectScale;
     rectScale.ltScale.x = 0.01;
@@ -123,11 +221,44 @@ int main(int argc, char** argv) {
     rectScale.rbScale.x = 0.99;
     rectScale.rbScale.y = 0.7;
 
+    if (sweepFile) {
+        return runSweep(sweepFile, goldenIn, goldenOut, rectScale);
+    }
+
+    if (!filePath)
+    {
+        std::cout << "./pelpleCounting [--mser] [--record cache] filename" << std::endl;
+        std::cout << "./pelpleCounting --sweep cache in out" << std::endl;
+        return -1;
+    }
+
+    // Frames, masks and the labellers' label buffers are recycled through the
+    // pool; once every buffer size has been seen, frames cost no allocations.
+    FramePool& pool = FramePool::instance();
+    myCompLabelerGroup::setBufferAllocator(&pool);
+
     BlobCounter counter;
     counter.init(cv::Size(320, 240), rectScale, LINE_HORIZONTAL, IO_DIRECTION_BOTTOM_TO_TOP);
 
+    // Only the counting area and an approach band around it is captured,
+    // preprocessed, sliced and tracked. Blobs cut by the band's outer edge are
+    // dropped, so the band has to hold a whole head: 48 rows fit a blob of
+    // about 1800 pixels before it reaches the counting area, the largest blobs
+    // below (6000 pixels, about 78 across) are whole once inside it, still well
+    // before the line in its middle. With the 0.3-0.7 area that keeps rows
+    // 24-215 of 240, a fifth less for every stage; at 80 rows the band covered
+    // the whole frame.
+    const int approachMargin = 48;
+    cv::Rect procRoi = counter.processingRoi(approachMargin);
+    StagePixels stagePixels;
+
     BlobTracker tracker(&counter);
     tracker.init();
+    tracker.setProcessingRoi(procRoi);
+    tracker.setStagePixels(&stagePixels);
+
+    // every 4th frame while nobody is within 40 pixels of the counting line
+    FrameScheduler scheduler(4, 40);
 
     int cnt = 0;
     int times = 0;
@@ -144,17 +275,21 @@ int main(int argc, char** argv) {
 
     cv::Rect roi(70, 10, 560, 460);
     //cv::Rect roi(0, 0, 320, 240);
+    cv::Rect capture = captureRect(roi, cv::Size(320, 240), procRoi);
 
     cv::Mat frame;
 
     frame.create(480, 640, CV_16UC1);
 
+    // The extracters slice height above the floor instead of camera distance.
+    // The floor model is read from config/FloorModel.xml; without one it is
+    // fitted on the first frame and saved there for the next run.
+    HeightTransformer heightTransformer;
+    bool floorLoaded = heightTransformer.loadFloor();
+
     cv::VideoWriter vw;
     vw.open("/home/android/CrossCompile/DepthCounter/debug/test.avi", CV_FOURCC('M', 'J', 'P', 'G'), 25.0, cv::Size(320, 240), false);
 
-    pthread_t tIds[2];
-    IOArgSt argSt[2];
-
     moodycamel::BlockingReaderWriterQueue<cv::Mat> queue;
 
     //while (!feof(fp)/*counter < 10000*/) {
@@ -164,9 +299,15 @@ int main(int argc, char** argv) {
 
         memcpy(frame.data, depth_buf, 640 * 480 * 2);
 
-        cv::Mat src = cv::Mat::zeros(240, 320, CV_16UC1);
+        cv::Mat src = pool.acquire(240, 320, CV_16UC1);
+        src.setTo(0);
 
-        cv::resize(frame(roi), src, src.size(), 0, 0, CV_INTER_NN);
+        cv::Mat part = src(procRoi);
+        cv::resize(frame(capture), part, part.size(), 0, 0, CV_INTER_NN);
+
+        if (!heightTransformer.hasFloor() && heightTransformer.fitFloor(src)) {
+            heightTransformer.saveFloor();
+        }
 
         //vw << objs;
 
@@ -183,39 +324,93 @@ int main(int argc, char** argv) {
     fps_counter = 0;
 //    AdaptableBlobsExtracter extracter1;
 //    AdaptableBlobsExtracter extracter2;
-    DepthBlobsExtracter extracter1(100, 10, 1000, 1000, 6000, 0.35, 0.9, 20);
-    DepthBlobsExtracter extracter2(10, 10, 2500, 500, 6000, 0.25, 0.9, 10);
-    argSt[0].extracter = &extracter1;
-    argSt[1].extracter = &extracter2;
-    argSt[0].oImage = cv::Mat::zeros(240, 320, CV_8UC1);
-    argSt[1].oImage = cv::Mat::zeros(240, 320, CV_8UC1);
-    int numThreads = 2;
+//    DepthBlobsExtracter extracter1(100, 10, 1000, 1000, 6000, 0.35, 0.9, 20);
+//    DepthBlobsExtracter extracter2(10, 10, 2500, 500, 6000, 0.25, 0.9, 10);
+    // both configurations share the layer labelling and run in parallel
+    // and slice at the persistent extrema of each frame's depth histogram
+    DepthBlobsEnsemble ensemble;
+    ensemble.addConfig(100, 10, 1000, 1000, 6000, 0.35, 0.9, 20).setAdaptiveSlicing(true);
+    ensemble.addConfig(10, 10, 2500, 500, 6000, 0.25, 0.9, 10).setAdaptiveSlicing(true);
+    ensemble.setProcessingRoi(procRoi);
+    ensemble.setStagePixels(&stagePixels);
+    // Only the tiles that differ from the learnt empty scene are sliced; an
+    // empty doorway costs the background update and nothing else.
+    BackgroundDepthModel background;
+    ensemble.setBackgroundModel(&background);
+    // Holes and flicker are smoothed on the raw depth, before the height
+    // transform, so split heads do not multiply the blobs to label.
+    TemporalDepthFilter depthFilter;
+    ensemble.addPreprocessor(&depthFilter);
+    if (heightTransformer.hasFloor()) {
+        // Heights are reported as the distance an untilted camera at the floor
+        // depth of the roi centre would see, so the near-to-far depth ranges of
+        // the configurations above still apply.
+        cv::Point centre(procRoi.x + procRoi.width/2, procRoi.y + procRoi.height/2);
+        heightTransformer.setReferenceHeight(heightTransformer.floor().at<ushort>(centre));
+        ensemble.addPreprocessor(&heightTransformer);
+        std::cout << "floor model " << (floorLoaded ? "loaded" : "fitted") << std::endl;
+    }
+
+    // The ensemble hands its blobs straight to the tracker: no mask is painted
+    // and relabelled. Set debugView to see them (the ensemble then also
+    // produces the runs to paint). One frame at a time, the ensemble runs its
+    // configurations in parallel itself and is not reentrant.
+    const bool debugView = false;
+    AdaptableBlobsExtracter mser(500, 6000, 20);
+    mser.setIncremental(5);
+    IExtracter* extracter = useMser ? (IExtracter*)&mser : (IExtracter*)&ensemble;
+    std::vector<cv::Rect> searchRegions;
+    int skipped = 0;
+    cv::Mat iImage;
+    std::vector<Detection> detections;
+    DetectionCacheWriter recorder;
+    if (recordFile && !recorder.open(recordFile, cv::Size(320, 240))) {
+        return -1;
+    }
+    cv::Mat mask;
+    cv::Mat drawer;
+    if (debugView) {
+        mask.create(240, 320, CV_8UC1);
+    }
     bool ready0 = false;
-    bool ready1 = false;
     for (;;) {
         ready0 = false;
-        ready1 = false;
 
         // Blocking with timeout
-        if (queue.wait_dequeue_timed(argSt[0].iImage, 100000)) {
+        if (queue.wait_dequeue_timed(iImage, 100000)) {
             ready0 = true;
         }
 
-//        if (queue.wait_dequeue_timed(argSt[1].iImage, 100000)) {
-//            ready1 = true;
-//        }
-        threadFunc(&argSt[0]);
-        if (ready0 /*&& ready1*/) {
-//            for(int i = 0; i < numThreads; i++) {
-//                pthread_create(&tIds[i], NULL, threadFunc, &argSt[i]);
-//            }
+        if (!ready0 && recorder.isOpened()) {
+            // every captured frame has been processed
+            recorder.close();
+            break;
+        }
+
+        if (ready0 && !recorder.isOpened() && !scheduler.next()) {
+            tracker.skipFrame();
+            ++skipped;
+            continue;
+        }
+
+        if (ready0) {
+            if (useMser) {
+                tracker.predictedRegions(searchRegions, skipped + 1);
+                mser.setSearchRegions(searchRegions);
+            }
+            skipped = 0;
+
+            extracter->detects(iImage, detections, debugView);
+            tracker.process(detections);
+            recorder.writeFrame(detections);
+            scheduler.update(tracker.tracks(), counter);
 
-//            for(int i = 0; i < numThreads; i++) {
-//                pthread_join(tIds[i], 0);
-//            }
+            if (debugView) {
+                showDetections(detections, tracker.tracks(), mask, drawer);
+            }
 
-            tracker.process(argSt[0].oImage);
-            //tracker.process(argSt[1].oImage);
+            stagePixels.addFrame(iImage.total());
+            stagePixels.capture += procRoi.area();
 
             int fps = get_fps();
             if (fps > 0) {
@@ -223,6 +418,12 @@ int main(int argc, char** argv) {
                 ++times;
                 total += fps;
                 std::cout << "avg = " << total/times << std::endl;
+                stagePixels.report(std::cout);
+                std::cout << std::endl;
+                pool.report(std::cout);
+                std::cout << std::endl;
+                std::cout << "processed " << scheduler.processed() << "/" << scheduler.frames()
+                          << (scheduler.idle() ? " idle" : " active") << std::endl;
             }
         }
     }
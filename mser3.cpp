@@ -46,6 +46,8 @@
 #include "opencv2/core/core.hpp"
 #include <limits>
 #include <vector>
+#include <iterator>
+#include <pthread.h>
 
 namespace cv
 {
@@ -71,6 +73,8 @@ public:
             minMargin = _min_margin;
             edgeBlurSize = _edge_blur_size;
             pass2Only = false;
+            depthMin = 0;
+            depthBucket = 0;
         }
 
         int delta;
@@ -79,6 +83,8 @@ public:
         double maxVariation;
         double minDiversity;
         bool pass2Only;
+        int depthMin;
+        int depthBucket;
 
         int maxEvolution;
         double areaThreshold;
@@ -86,9 +92,32 @@ public:
         int edgeBlurSize;
     };
 
-    explicit MSER_Impl3(const Params& _params) : params(_params) {}
+    explicit MSER_Impl3(const Params& _params) : params(_params)
+    {
+        lastDepthMin = 0;
+        lastDepthBucket = 0;
+        workerStarted = false;
+        jobPending = false;
+        stopWorker = false;
+        pthread_mutex_init(&workerMutex, NULL);
+        pthread_cond_init(&jobCond, NULL);
+        pthread_cond_init(&doneCond, NULL);
+    }
 
-    virtual ~MSER_Impl3() {}
+    virtual ~MSER_Impl3()
+    {
+        if( workerStarted )
+        {
+            pthread_mutex_lock(&workerMutex);
+            stopWorker = true;
+            pthread_cond_signal(&jobCond);
+            pthread_mutex_unlock(&workerMutex);
+            pthread_join(workerId, 0);
+        }
+        pthread_cond_destroy(&doneCond);
+        pthread_cond_destroy(&jobCond);
+        pthread_mutex_destroy(&workerMutex);
+    }
 
     void setDelta(int delta) { params.delta = delta; }
     int getDelta() const { return params.delta; }
@@ -102,6 +131,21 @@ public:
     void setPass2Only(bool f) { params.pass2Only = f; }
     bool getPass2Only() const { return params.pass2Only; }
 
+    void setDepthMin(int minDepth) { params.depthMin = minDepth; }
+    int getDepthMin() const { return params.depthMin; }
+
+    void setDepthBucket(int bucketSize) { params.depthBucket = bucketSize; }
+    int getDepthBucket() const { return params.depthBucket; }
+
+    void getLastQuantization(int& minDepth, int& bucketSize) const
+    {
+        minDepth = lastDepthMin;
+        bucketSize = lastDepthBucket;
+    }
+
+    // gray level reserved for unknown (zero) depth pixels of 16UC1 images
+    enum { UNKNOWN_LEVEL = 255 };
+
     enum { DIR_SHIFT = 29, NEXT_MASK = ((1<<DIR_SHIFT)-1)  };
 
     struct Pixel
@@ -131,6 +175,7 @@ public:
         vector<Rect>* bboxvec;
         Pixel* pix0;
         int step;
+        int unknownLevel;
     };
 
     // the history of region grown
@@ -205,6 +250,8 @@ public:
             checked = true;
             if( size < wp.p.minArea || size > wp.p.maxArea || var < 0.f || var > wp.p.maxVariation )
                 return;
+            if( val >= wp.unknownLevel )
+                return;
             if( child_ )
             {
                 CompHistory* c = child_;
@@ -369,65 +416,125 @@ public:
                         std::vector<Rect>& bboxes );
     void detect( InputArray _src, vector<KeyPoint>& keypoints, InputArray _mask );
 
-    void preprocess1( const Mat& img, int* level_size )
+    // per-pass scratch memory, kept by the detector so that frames of the
+    // same size reuse it and the two polarity passes can run side by side
+    struct Scratch
     {
-        memset(level_size, 0, 256*sizeof(level_size[0]));
+        vector<Pixel> pixbuf;
+        vector<Pixel*> heapbuf;
+        vector<CompHistory> histbuf;
+    };
 
-        int i, j, cols = img.cols, rows = img.rows;
+    void prepareScratch( Scratch& sc, int rows, int cols )
+    {
+        int i, j;
         int step = cols;
-        pixbuf.resize(step*rows);
-        heapbuf.resize(cols*rows + 256);
-        histbuf.resize(cols*rows);
+        sc.pixbuf.resize(step*rows);
+        sc.heapbuf.resize(cols*rows + 256);
+        sc.histbuf.resize(cols*rows);
         Pixel borderpix;
         borderpix.setDir(5);
 
         for( j = 0; j < step; j++ )
         {
-            pixbuf[j] = pixbuf[j + (rows-1)*step] = borderpix;
+            sc.pixbuf[j] = sc.pixbuf[j + (rows-1)*step] = borderpix;
         }
 
         for( i = 1; i < rows-1; i++ )
         {
-            const uchar* imgptr = img.ptr(i);
-            Pixel* pptr = &pixbuf[i*step];
+            Pixel* pptr = &sc.pixbuf[i*step];
             pptr[0] = pptr[cols-1] = borderpix;
             for( j = 1; j < cols-1; j++ )
             {
-                int val = imgptr[j];
-                level_size[val]++;
                 pptr[j].val = 0;
             }
         }
     }
 
-    void preprocess2( const Mat& img, int* level_size )
+    void preprocess1( const Mat& img, int* level_size )
+    {
+        memset(level_size, 0, 256*sizeof(level_size[0]));
+
+        int i, j, cols = img.cols, rows = img.rows;
+
+        for( i = 1; i < rows-1; i++ )
+        {
+            const uchar* imgptr = img.ptr(i);
+            for( j = 1; j < cols-1; j++ )
+            {
+                level_size[imgptr[j]]++;
+            }
+        }
+    }
+
+    void preprocess2( const int* level_size1, int* level_size )
     {
-        int i;
+        for( int i = 0; i < 256; i++ )
+            level_size[i] = level_size1[255-i];
+    }
 
-        for( i = 0; i < 128; i++ )
-            std::swap(level_size[i], level_size[255-i]);
+    // quantize a 16UC1 depth image into the two 8-bit level images walked by pass():
+    // known depth goes to [0, UNKNOWN_LEVEL) near to far (lv1) and far to near (lv2),
+    // unknown pixels stay on UNKNOWN_LEVEL in both so they are always flooded last
+    void preprocess16( const Mat& img, Mat& lv1, Mat& lv2 )
+    {
+        int i, j, cols = img.cols, rows = img.rows;
+        int dmin = params.depthMin, bucket = params.depthBucket;
 
-        if( !params.pass2Only )
+        if( bucket <= 0 )
+        {
+            int lo = INT_MAX, hi = 0;
+            for( i = 0; i < rows; i++ )
+            {
+                const ushort* imgptr = img.ptr<ushort>(i);
+                for( j = 0; j < cols; j++ )
+                {
+                    int d = imgptr[j];
+                    if( d != 0 )
+                    {
+                        lo = std::min(lo, d);
+                        hi = std::max(hi, d);
+                    }
+                }
+            }
+            if( hi == 0 )
+                lo = 0;
+            dmin = lo;
+            bucket = (hi - lo)/(UNKNOWN_LEVEL - 1) + 1;
+        }
+        lastDepthMin = dmin;
+        lastDepthBucket = bucket;
+
+        lv1.create(rows, cols, CV_8UC1);
+        lv2.create(rows, cols, CV_8UC1);
+
+        for( i = 0; i < rows; i++ )
         {
-            int j, cols = img.cols, rows = img.rows;
-            int step = cols;
-            for( i = 1; i < rows-1; i++ )
+            const ushort* imgptr = img.ptr<ushort>(i);
+            uchar* ptr1 = lv1.ptr(i);
+            uchar* ptr2 = lv2.ptr(i);
+            for( j = 0; j < cols; j++ )
             {
-                Pixel* pptr = &pixbuf[i*step];
-                for( j = 1; j < cols-1; j++ )
+                int d = imgptr[j];
+                if( d == 0 )
                 {
-                    pptr[j].val = 0;
+                    ptr1[j] = ptr2[j] = (uchar)UNKNOWN_LEVEL;
+                    continue;
                 }
+                int lv = (d - dmin)/bucket;
+                lv = std::min(std::max(lv, 0), UNKNOWN_LEVEL - 1);
+                ptr1[j] = (uchar)lv;
+                ptr2[j] = (uchar)(UNKNOWN_LEVEL - 1 - lv);
             }
         }
     }
 
     void pass( const Mat& img, vector<vector<Point> >& msers, vector<Rect>& bboxvec,
-               Size size, const int* level_size, int mask )
+               Size size, const int* level_size, int mask, Scratch& sc, int unknownLevel = 256 )
     {
-        CompHistory* histptr = &histbuf[0];
+        CompHistory* histptr = &sc.histbuf[0];
         int step = size.width;
-        Pixel *ptr0 = &pixbuf[0], *ptr = &ptr0[step+1];
+        Pixel *ptr0 = &sc.pixbuf[0], *ptr = &ptr0[step+1];
         const uchar* imgptr0 = img.ptr();
         Pixel** heap[256];
         ConnectedComp comp[257];
@@ -438,8 +545,9 @@ public:
         wp.bboxvec = &bboxvec;
         wp.pix0 = ptr0;
         wp.step = step;
+        wp.unknownLevel = unknownLevel;
 
-        heap[0] = &heapbuf[0];
+        heap[0] = &sc.heapbuf[0];
         heap[0][0] = 0;
 
         for( int i = 1; i < 256; i++ )
@@ -540,10 +648,71 @@ public:
         }
     }
 
+    // MSER+ pass run on a worker thread while MSER- runs on the caller's thread.
+    // The worker is started by the first detection and lives as long as the
+    // detector; each call hands it a job and waits for it on condition variables.
+    struct PassJob
+    {
+        const Mat* img;
+        Size size;
+        const int* level_size;
+        int mask;
+        int unknownLevel;
+    };
+
+    void runPass1()
+    {
+        prepareScratch( scratch[0], job.size.height, job.size.width );
+        pass( *job.img, msers1, bboxes1, job.size, job.level_size,
+              job.mask, scratch[0], job.unknownLevel );
+    }
+
+    static void* thread_Pass( void* arg )
+    {
+        MSER_Impl3* self = (MSER_Impl3*)arg;
+        pthread_mutex_lock(&self->workerMutex);
+        for( ;; )
+        {
+            while( !self->jobPending && !self->stopWorker )
+                pthread_cond_wait(&self->jobCond, &self->workerMutex);
+            if( self->stopWorker )
+                break;
+
+            pthread_mutex_unlock(&self->workerMutex);
+            self->runPass1();
+            pthread_mutex_lock(&self->workerMutex);
+
+            self->jobPending = false;
+            pthread_cond_signal(&self->doneCond);
+        }
+        pthread_mutex_unlock(&self->workerMutex);
+        return 0;
+    }
+
+    void detectBoth( const Mat& img1, const int* level_size1,
+                     const Mat& img2, const int* level_size2,
+                     int mask1, int mask2, int unknownLevel,
+                     vector<vector<Point> >& msers, vector<Rect>& bboxes );
+
     Mat tempsrc;
-    vector<Pixel> pixbuf;
-    vector<Pixel*> heapbuf;
-    vector<CompHistory> histbuf;
+    Mat levelsrc[2];
+    Scratch scratch[2];
+    vector<vector<Point> > msers1;
+    vector<Rect> bboxes1;
+    vector<vector<Point> > msers2;
+    vector<Rect> bboxes2;
+
+    PassJob job;
+    pthread_t workerId;
+    pthread_mutex_t workerMutex;
+    pthread_cond_t jobCond;
+    pthread_cond_t doneCond;
+    bool workerStarted;
+    bool jobPending;
+    bool stopWorker;
+
+    int lastDepthMin;
+    int lastDepthBucket;
 
     Params params;
 };
@@ -1051,20 +1220,28 @@ void MSER_Impl3::detectRegions( InputArray _src, vector<vector<Point> >& msers,
 
     if( src.type() == CV_8U )
     {
-        int level_size[256];
+        int level_size[256], level_size2[256];
         if( !src.isContinuous() )
         {
             src.copyTo(tempsrc);
             src = tempsrc;
         }
 
-        // darker to brighter (MSER+)
+        // darker to brighter (MSER+) and brighter to darker (MSER-)
         preprocess1( src, level_size );
+        preprocess2( level_size, level_size2 );
+        detectBoth( src, level_size, src, level_size2, 0, 255, 256, msers, bboxes );
+    }
+    else if( src.type() == CV_16UC1 )
+    {
+        int level_size[256], level_size2[256];
+        preprocess16( src, levelsrc[0], levelsrc[1] );
+
+        // near to far (MSER+) and far to near (MSER-)
         if( !params.pass2Only )
-            pass( src, msers, bboxes, size, level_size, 0 );
-        // brighter to darker (MSER-)
-        preprocess2( src, level_size );
-        pass( src, msers, bboxes, size, level_size, 255 );
+            preprocess1( levelsrc[0], level_size );
+        preprocess1( levelsrc[1], level_size2 );
+        detectBoth( levelsrc[0], level_size, levelsrc[1], level_size2, 0, 0, UNKNOWN_LEVEL, msers, bboxes );
     }
     else
     {
@@ -1073,6 +1250,62 @@ void MSER_Impl3::detectRegions( InputArray _src, vector<vector<Point> >& msers,
     }
 }
 
+void MSER_Impl3::detectBoth( const Mat& img1, const int* level_size1,
+                             const Mat& img2, const int* level_size2,
+                             int mask1, int mask2, int unknownLevel,
+                             vector<vector<Point> >& msers, vector<Rect>& bboxes )
+{
+    Size size = img2.size();
+
+    if( params.pass2Only )
+    {
+        prepareScratch( scratch[1], size.height, size.width );
+        pass( img2, msers, bboxes, size, level_size2, mask2, scratch[1], unknownLevel );
+        return;
+    }
+
+    msers1.clear();
+    bboxes1.clear();
+
+    job.img = &img1;
+    job.size = size;
+    job.level_size = level_size1;
+    job.mask = mask1;
+    job.unknownLevel = unknownLevel;
+
+    if( !workerStarted )
+        workerStarted = pthread_create(&workerId, NULL, MSER_Impl3::thread_Pass, this) == 0;
+
+    if( workerStarted )
+    {
+        pthread_mutex_lock(&workerMutex);
+        jobPending = true;
+        pthread_cond_signal(&jobCond);
+        pthread_mutex_unlock(&workerMutex);
+    }
+    else
+        runPass1();
+
+    msers2.clear();
+    bboxes2.clear();
+    prepareScratch( scratch[1], size.height, size.width );
+    pass( img2, msers2, bboxes2, size, level_size2, mask2, scratch[1], unknownLevel );
+
+    if( workerStarted )
+    {
+        pthread_mutex_lock(&workerMutex);
+        while( jobPending )
+            pthread_cond_wait(&doneCond, &workerMutex);
+        pthread_mutex_unlock(&workerMutex);
+    }
+
+    // keep the MSER+ regions first, as the serial version did
+    msers.swap(msers1);
+    bboxes.swap(bboxes1);
+    msers.insert(msers.end(), std::make_move_iterator(msers2.begin()), std::make_move_iterator(msers2.end()));
+    bboxes.insert(bboxes.end(), bboxes2.begin(), bboxes2.end());
+}
+
 void MSER_Impl3::detect( InputArray _image, vector<KeyPoint>& keypoints, InputArray _mask )
 {
     //    CV_INSTRUMENT_REGION();
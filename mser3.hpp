@@ -27,7 +27,9 @@ public:
           double _min_margin=0.003, int _edge_blur_size=5 );
 
     /** @brief Detect %MSER regions
-    @param image input image (8UC1, 8UC3 or 8UC4, must be greater or equal than 3x3)
+    @param image input image (8UC1, 16UC1, 8UC3 or 8UC4, must be greater or equal than 3x3).
+    16UC1 depth images are quantized into buckets (see setDepthMin/setDepthBucket), zero pixels
+    are treated as unknown depth and never become part of a detected region
     @param msers resulting list of point sets
     @param bboxes resulting bounding boxes
     */
@@ -46,6 +48,20 @@ public:
 
     virtual void setPass2Only(bool f) = 0;
     virtual bool getPass2Only() const = 0;
+
+    /** @brief depth mapped to the first bucket of a 16UC1 image */
+    virtual void setDepthMin(int minDepth) = 0;
+    virtual int getDepthMin() const = 0;
+
+    /** @brief depth range covered by one bucket of a 16UC1 image,
+    <= 0 derives it (and the minimum depth) from the known pixels of every frame */
+    virtual void setDepthBucket(int bucketSize) = 0;
+    virtual int getDepthBucket() const = 0;
+
+    /** @brief minimum depth and bucket size the last 16UC1 detection quantized with,
+    the derived ones when no bucket is set; pass them to setDepthMin/setDepthBucket to
+    scan parts of later frames with the same depth steps */
+    virtual void getLastQuantization(int& minDepth, int& bucketSize) const = 0;
 };
 
 }